@@ -9,7 +9,7 @@ SDL_TTF_PATH := ../SDL_ttf
 
 LOCAL_C_INCLUDES := $(LOCAL_PATH)/$(SDL_PATH)/include $(LOCAL_PATH)/$(SDL_TTF_PATH)/include
 
-LOCAL_SRC_FILES := srcs/main.c srcs/getarg.c srcs/card.c srcs/clock.c srcs/flipclock.c
+LOCAL_SRC_FILES := srcs/main.c srcs/getarg.c srcs/atlas.c srcs/canvas.c srcs/sdf.c srcs/font.c srcs/card.c srcs/clock.c srcs/timer.c srcs/queue.c srcs/stats.c srcs/trace.c srcs/worker.c srcs/tiles.c srcs/cache.c srcs/router.c srcs/zone.c srcs/layout.c srcs/counter.c srcs/flipclock.c
 
 LOCAL_SHARED_LIBRARIES := SDL2 SDL2_ttf
 
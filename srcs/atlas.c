@@ -0,0 +1,503 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipclock.h"
+#include "atlas.h"
+#include "cache.h"
+#include "sdf.h"
+
+// Leave some space between glyphs so linear filtering won't bleed.
+#define ATLAS_PADDING 1
+#define DEFAULT_MAX_TEXTURE_SIZE 4096
+
+/**
+ * Put glyphs in rows by sizes in rects, start a new row if current one is
+ * full.
+ */
+static void _flipclock_atlas_layout(struct flipclock_atlas *atlas, int *width,
+				    int *height)
+{
+	int x = 0;
+	int y = 0;
+	int row_height = 0;
+	*width = 0;
+	for (int i = 0; i < ATLAS_GLYPHS_LENGTH; ++i) {
+		SDL_Rect *rect = &atlas->rects[i];
+		if (x > 0 && x + rect->w > atlas->max_width) {
+			x = 0;
+			y += row_height + ATLAS_PADDING;
+			row_height = 0;
+		}
+		rect->x = x;
+		rect->y = y;
+		x += rect->w + ATLAS_PADDING;
+		if (x > *width)
+			*width = x;
+		if (rect->h > row_height)
+			row_height = rect->h;
+	}
+	*height = y + row_height;
+}
+
+/**
+ * Coverage is kept for composing faces by CPU, otherwise it is converted into
+ * a surface in text color for uploading.
+ */
+static void _flipclock_atlas_finish(struct flipclock_atlas *atlas,
+				    Uint8 *coverage, int width, int height)
+{
+	if (atlas->keep_coverage) {
+		atlas->coverage = coverage;
+		atlas->coverage_pitch = width;
+		return;
+	}
+	SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+		0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+	if (surface == NULL) {
+		LOG_ERROR("%s\n", SDL_GetError());
+		exit(EXIT_FAILURE);
+	}
+	const Uint32 color = ((Uint32)atlas->color.r << 16) |
+			     ((Uint32)atlas->color.g << 8) |
+			     (Uint32)atlas->color.b;
+	for (int y = 0; y < height; ++y) {
+		Uint32 *row = (Uint32 *)((Uint8 *)surface->pixels +
+					 y * surface->pitch);
+		for (int x = 0; x < width; ++x)
+			row[x] = ((Uint32)coverage[y * width + x] << 24) |
+				 color;
+	}
+	free(coverage);
+	atlas->surface = surface;
+}
+
+static void _flipclock_atlas_rasterize(void *data)
+{
+	struct flipclock_atlas *atlas = data;
+
+	int width;
+	int height;
+	Uint8 *coverage = NULL;
+	// Only open font if we don't have it in cache.
+	if (atlas->cache != NULL &&
+	    flipclock_cache_load_atlas(atlas->cache, atlas->size,
+				       atlas->color.a, atlas->rects, &coverage,
+				       &width, &height)) {
+		LOG_DEBUG("Loaded atlas with size `%dx%d` from cache.\n",
+			  width, height);
+		atlas->cached = true;
+		_flipclock_atlas_finish(atlas, coverage, width, height);
+		return;
+	}
+
+	/**
+	 * See <https://www.libsdl.org/projects/SDL_ttf/docs/SDL_ttf_42.html#SEC42>.
+	 * Normally shaded is enough, however we have a rounded box,
+	 * and many fonts' boxes are too big compared with their
+	 * characters, they just cover the rounded corner.
+	 * So I have to use blended mode, because solid mode does not
+	 * have anti-alias.
+	 */
+	SDL_Surface *glyphs[ATLAS_GLYPHS_LENGTH];
+	// Fonts are shared with other threads.
+	flipclock_fonts_lock(atlas->fonts);
+	atlas->font = flipclock_fonts_open(atlas->fonts, atlas->size);
+	for (int i = 0; i < ATLAS_GLYPHS_LENGTH; ++i) {
+		glyphs[i] = TTF_RenderGlyph_Blended(atlas->font,
+						    ATLAS_GLYPHS[i],
+						    atlas->color);
+		if (glyphs[i] == NULL) {
+			LOG_ERROR("%s\n", TTF_GetError());
+			exit(EXIT_FAILURE);
+		}
+		atlas->rects[i].w = glyphs[i]->w;
+		atlas->rects[i].h = glyphs[i]->h;
+	}
+	flipclock_fonts_unlock(atlas->fonts);
+	_flipclock_atlas_layout(atlas, &width, &height);
+
+	LOG_DEBUG("Creating atlas with size `%dx%d`.\n", width, height);
+	coverage = calloc(width * height, 1);
+	if (coverage == NULL) {
+		LOG_ERROR("Failed to create atlas coverage!\n");
+		exit(EXIT_FAILURE);
+	}
+	// Blended glyphs are text color with alpha as coverage.
+	for (int i = 0; i < ATLAS_GLYPHS_LENGTH; ++i) {
+		const SDL_Rect *rect = &atlas->rects[i];
+		for (int y = 0; y < rect->h; ++y) {
+			const Uint32 *row =
+				(const Uint32 *)((Uint8 *)glyphs[i]->pixels +
+						 y * glyphs[i]->pitch);
+			Uint8 *target = coverage + (rect->y + y) * width +
+					rect->x;
+			for (int x = 0; x < rect->w; ++x)
+				target[x] = row[x] >> 24;
+		}
+		SDL_FreeSurface(glyphs[i]);
+	}
+	if (atlas->cache != NULL)
+		flipclock_cache_store_atlas(atlas->cache, atlas->size,
+					    atlas->color.a, atlas->rects,
+					    coverage, width, height);
+	_flipclock_atlas_finish(atlas, coverage, width, height);
+}
+
+// Same as rasterizing, but glyphs are sampled from distance field.
+static void _flipclock_atlas_sample(void *data)
+{
+	struct flipclock_atlas *atlas = data;
+
+	for (int i = 0; i < ATLAS_GLYPHS_LENGTH; ++i)
+		flipclock_sdf_get_glyph_size(atlas->sdf, i, atlas->size,
+					     &atlas->rects[i].w,
+					     &atlas->rects[i].h);
+	int width;
+	int height;
+	_flipclock_atlas_layout(atlas, &width, &height);
+	LOG_DEBUG("Sampling atlas with size `%dx%d`.\n", width, height);
+	Uint8 *coverage = calloc(width * height, 1);
+	if (coverage == NULL) {
+		LOG_ERROR("Failed to create atlas coverage!\n");
+		exit(EXIT_FAILURE);
+	}
+	// Glyph alpha contains alpha of text color, like FreeType does.
+	for (int i = 0; i < ATLAS_GLYPHS_LENGTH; ++i)
+		flipclock_sdf_render_glyph(atlas->sdf, i, atlas->size,
+					   atlas->color.a,
+					   coverage +
+						   atlas->rects[i].y * width +
+						   atlas->rects[i].x,
+					   width);
+	_flipclock_atlas_finish(atlas, coverage, width, height);
+}
+
+static struct flipclock_atlas *
+_flipclock_atlas_create(SDL_Renderer *renderer, SDL_Color color,
+			bool keep_coverage, struct flipclock_workers *workers)
+{
+	struct flipclock_atlas *atlas = malloc(sizeof(*atlas));
+	if (atlas == NULL) {
+		LOG_ERROR("Failed to create atlas!\n");
+		exit(EXIT_FAILURE);
+	}
+	atlas->renderer = renderer;
+	atlas->tiles = NULL;
+	atlas->fonts = NULL;
+	atlas->font = NULL;
+	atlas->workers = workers;
+	atlas->cache = NULL;
+	atlas->sdf = NULL;
+	atlas->size = 0;
+	atlas->color = color;
+	atlas->surface = NULL;
+	atlas->keep_coverage = keep_coverage;
+	atlas->coverage = NULL;
+	atlas->coverage_pitch = 0;
+	atlas->cached = false;
+	atlas->ready = false;
+	atlas->refs = 0;
+
+	// Renderer is not thread-safe, so query it before pushing the job.
+	SDL_RendererInfo info;
+	atlas->max_width = DEFAULT_MAX_TEXTURE_SIZE;
+	if (SDL_GetRendererInfo(renderer, &info) == 0 &&
+	    info.max_texture_width > 0)
+		atlas->max_width = info.max_texture_width;
+	return atlas;
+}
+
+/**
+ * Font of the size is only opened by workers if glyphs are not in cache, and
+ * kept until atlas is destroyed. Cache can be NULL to always rasterize them.
+ * Workers can be NULL to rasterize glyphs in current thread.
+ */
+struct flipclock_atlas *
+flipclock_atlas_create(SDL_Renderer *renderer, struct flipclock_fonts *fonts,
+		       struct flipclock_cache *cache, int size, SDL_Color color,
+		       bool keep_coverage, struct flipclock_workers *workers)
+{
+	RETURN_VAL_IF_FAIL(renderer != NULL, NULL);
+	RETURN_VAL_IF_FAIL(fonts != NULL, NULL);
+
+	struct flipclock_atlas *atlas = _flipclock_atlas_create(
+		renderer, color, keep_coverage, workers);
+	atlas->fonts = fonts;
+	atlas->cache = cache;
+	atlas->size = size;
+	flipclock_job_init(&atlas->job, _flipclock_atlas_rasterize, atlas);
+	flipclock_workers_push(workers, &atlas->job);
+	return atlas;
+}
+
+/**
+ * Distance field is shared by all atlases and must be kept until they are
+ * destroyed. It does not need fonts, so no locks are taken.
+ */
+struct flipclock_atlas *
+flipclock_atlas_create_from_sdf(SDL_Renderer *renderer,
+				const struct flipclock_sdf *sdf, int size,
+				SDL_Color color, bool keep_coverage,
+				struct flipclock_workers *workers)
+{
+	RETURN_VAL_IF_FAIL(renderer != NULL, NULL);
+	RETURN_VAL_IF_FAIL(sdf != NULL, NULL);
+
+	struct flipclock_atlas *atlas = _flipclock_atlas_create(
+		renderer, color, keep_coverage, workers);
+	atlas->sdf = sdf;
+	atlas->size = size;
+	flipclock_job_init(&atlas->job, _flipclock_atlas_sample, atlas);
+	flipclock_workers_push(workers, &atlas->job);
+	return atlas;
+}
+
+static void _flipclock_atlas_upload(struct flipclock_atlas *atlas)
+{
+	RETURN_IF_FAIL(atlas != NULL);
+
+	flipclock_workers_wait(atlas->workers, &atlas->job);
+	atlas->ready = true;
+	// Coverage is used by CPU directly.
+	if (atlas->keep_coverage)
+		return;
+	atlas->tiles = flipclock_tiles_create_from_surface(atlas->renderer,
+							   atlas->surface);
+	SDL_FreeSurface(atlas->surface);
+	atlas->surface = NULL;
+	flipclock_tiles_set_blend_mode(atlas->tiles, SDL_BLENDMODE_BLEND);
+}
+
+/**
+ * Returns false if glyphs are still being rasterized, so callers can keep old
+ * contents instead of waiting for it.
+ */
+bool flipclock_atlas_is_ready(struct flipclock_atlas *atlas)
+{
+	RETURN_VAL_IF_FAIL(atlas != NULL, false);
+
+	if (atlas->ready)
+		return true;
+	if (!flipclock_job_is_done(&atlas->job))
+		return false;
+	_flipclock_atlas_upload(atlas);
+	return true;
+}
+
+// Wait for workers, for callers that cannot keep old contents.
+void flipclock_atlas_wait(struct flipclock_atlas *atlas)
+{
+	RETURN_IF_FAIL(atlas != NULL);
+
+	if (!atlas->ready)
+		_flipclock_atlas_upload(atlas);
+}
+
+/**
+ * All chars are placed as mono, each one is centered in its part of target
+ * rect. Returns false if we don't have the glyph.
+ */
+static bool
+_flipclock_atlas_place_glyph(const struct flipclock_atlas *atlas,
+			     SDL_Rect target_rect, const char text[], int len,
+			     int i, SDL_Rect *glyph_rect, SDL_Rect *text_rect)
+{
+	const char *glyph = strchr(ATLAS_GLYPHS, text[i]);
+	/**
+	 * We only have glyphs that a card uses, this runs for every frame, so
+	 * don't flood logs with the same char.
+	 */
+	if (glyph == NULL || *glyph == '\0') {
+		LOG_DEBUG("No glyph for `%c` in atlas!\n", text[i]);
+		return false;
+	}
+	*glyph_rect = atlas->rects[glyph - ATLAS_GLYPHS];
+	text_rect->x = target_rect.x + target_rect.w / len * i +
+		       (target_rect.w / len - glyph_rect->w) / 2;
+	text_rect->y = target_rect.y + (target_rect.h - glyph_rect->h) / 2;
+	text_rect->w = glyph_rect->w;
+	text_rect->h = glyph_rect->h;
+	return true;
+}
+
+// A special text drawing function, will draw all chars as mono.
+void flipclock_atlas_draw_text(struct flipclock_atlas *atlas,
+			       SDL_Rect target_rect, const char text[])
+{
+	RETURN_IF_FAIL(atlas != NULL);
+	RETURN_IF_FAIL(text != NULL);
+
+	// Wait for workers if caller does not check it.
+	flipclock_atlas_wait(atlas);
+	RETURN_IF_FAIL(atlas->tiles != NULL);
+	int len = strlen(text);
+	LOG_DEBUG("Drawing text `%s`.\n", text);
+	for (int i = 0; i < len; ++i) {
+		SDL_Rect glyph_rect;
+		SDL_Rect text_rect;
+		if (!_flipclock_atlas_place_glyph(atlas, target_rect, text, len,
+						  i, &glyph_rect, &text_rect))
+			continue;
+		flipclock_tiles_copy(atlas->tiles, &glyph_rect, &text_rect);
+	}
+}
+
+// Same as `draw_text()` but blends coverage on canvas by CPU.
+void flipclock_atlas_compose_text(struct flipclock_atlas *atlas,
+				  struct flipclock_canvas *canvas,
+				  SDL_Rect target_rect, const char text[])
+{
+	RETURN_IF_FAIL(atlas != NULL);
+	RETURN_IF_FAIL(canvas != NULL);
+	RETURN_IF_FAIL(text != NULL);
+
+	// Workers composing bands can't wait, it must be ready before.
+	RETURN_IF_FAIL(atlas->ready);
+	RETURN_IF_FAIL(atlas->coverage != NULL);
+	// Glyph alpha already contains alpha of text color.
+	SDL_Color color = atlas->color;
+	color.a = 0xff;
+	int len = strlen(text);
+	LOG_DEBUG("Composing text `%s`.\n", text);
+	for (int i = 0; i < len; ++i) {
+		SDL_Rect glyph_rect;
+		SDL_Rect text_rect;
+		if (!_flipclock_atlas_place_glyph(atlas, target_rect, text, len,
+						  i, &glyph_rect, &text_rect))
+			continue;
+		flipclock_canvas_blend_mask(
+			canvas, text_rect,
+			atlas->coverage + glyph_rect.y * atlas->coverage_pitch +
+				glyph_rect.x,
+			atlas->coverage_pitch, color);
+	}
+}
+
+/**
+ * Rect that glyphs of text cover when drawn in target rect, it is empty if no
+ * glyph is found.
+ */
+SDL_Rect flipclock_atlas_get_text_rect(const struct flipclock_atlas *atlas,
+				       SDL_Rect target_rect, const char text[])
+{
+	SDL_Rect rect = { 0, 0, 0, 0 };
+	RETURN_VAL_IF_FAIL(atlas != NULL, rect);
+	RETURN_VAL_IF_FAIL(text != NULL, rect);
+
+	int len = strlen(text);
+	for (int i = 0; i < len; ++i) {
+		SDL_Rect glyph_rect;
+		SDL_Rect text_rect;
+		if (!_flipclock_atlas_place_glyph(atlas, target_rect, text, len,
+						  i, &glyph_rect, &text_rect))
+			continue;
+		SDL_UnionRect(&rect, &text_rect, &rect);
+	}
+	return rect;
+}
+
+void flipclock_atlas_destroy(struct flipclock_atlas *atlas)
+{
+	RETURN_IF_FAIL(atlas != NULL);
+
+	// Worker may still use it.
+	flipclock_workers_wait(atlas->workers, &atlas->job);
+	if (atlas->surface != NULL)
+		SDL_FreeSurface(atlas->surface);
+	free(atlas->coverage);
+	if (atlas->tiles != NULL)
+		flipclock_tiles_destroy(atlas->tiles);
+	if (atlas->font != NULL)
+		flipclock_fonts_close(atlas->fonts, atlas->font);
+	free(atlas);
+}
+
+struct flipclock_atlases *
+flipclock_atlases_create(SDL_Renderer *renderer, struct flipclock_fonts *fonts,
+			 struct flipclock_cache *cache,
+			 const struct flipclock_sdf *sdf, SDL_Color color,
+			 struct flipclock_workers *workers)
+{
+	RETURN_VAL_IF_FAIL(renderer != NULL, NULL);
+	RETURN_VAL_IF_FAIL(fonts != NULL || sdf != NULL, NULL);
+
+	struct flipclock_atlases *atlases = malloc(sizeof(*atlases));
+	if (atlases == NULL) {
+		LOG_ERROR("Failed to create atlases!\n");
+		exit(EXIT_FAILURE);
+	}
+	atlases->renderer = renderer;
+	atlases->fonts = fonts;
+	atlases->cache = cache;
+	atlases->sdf = sdf;
+	atlases->color = color;
+	atlases->workers = workers;
+	atlases->atlases_length = 0;
+	return atlases;
+}
+
+// Glyphs are only rasterized or sampled for the first card of a size.
+struct flipclock_atlas *
+flipclock_atlases_open(struct flipclock_atlases *atlases, int size,
+		       bool keep_coverage)
+{
+	RETURN_VAL_IF_FAIL(atlases != NULL, NULL);
+
+	for (int i = 0; i < atlases->atlases_length; ++i) {
+		struct flipclock_atlas *atlas = atlases->atlases[i];
+		if (atlas->size == size &&
+		    atlas->keep_coverage == keep_coverage) {
+			++atlas->refs;
+			return atlas;
+		}
+	}
+	if (atlases->atlases_length == MAX_ATLASES) {
+		LOG_ERROR("Too many atlases opened!\n");
+		exit(EXIT_FAILURE);
+	}
+	LOG_DEBUG("Opening atlas with size `%d`.\n", size);
+	struct flipclock_atlas *atlas;
+	if (atlases->sdf != NULL)
+		atlas = flipclock_atlas_create_from_sdf(
+			atlases->renderer, atlases->sdf, size, atlases->color,
+			keep_coverage, atlases->workers);
+	else
+		atlas = flipclock_atlas_create(atlases->renderer,
+					       atlases->fonts, atlases->cache,
+					       size, atlases->color,
+					       keep_coverage, atlases->workers);
+	atlas->refs = 1;
+	atlases->atlases[atlases->atlases_length++] = atlas;
+	return atlas;
+}
+
+void flipclock_atlases_close(struct flipclock_atlases *atlases,
+			     struct flipclock_atlas *atlas)
+{
+	RETURN_IF_FAIL(atlases != NULL);
+	RETURN_IF_FAIL(atlas != NULL);
+
+	for (int i = 0; i < atlases->atlases_length; ++i) {
+		if (atlases->atlases[i] != atlas)
+			continue;
+		if (--atlas->refs == 0) {
+			LOG_DEBUG("Closing atlas with size `%d`.\n",
+				  atlas->size);
+			flipclock_atlas_destroy(atlas);
+			// Order does not matter, move the last one here.
+			atlases->atlases[i] =
+				atlases->atlases[atlases->atlases_length - 1];
+			--atlases->atlases_length;
+		}
+		break;
+	}
+}
+
+void flipclock_atlases_destroy(struct flipclock_atlases *atlases)
+{
+	RETURN_IF_FAIL(atlases != NULL);
+
+	for (int i = 0; i < atlases->atlases_length; ++i)
+		flipclock_atlas_destroy(atlases->atlases[i]);
+	free(atlases);
+}
@@ -0,0 +1,115 @@
+#ifndef __ATLAS_H__
+#define __ATLAS_H__
+
+#include <stdbool.h>
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+#include "canvas.h"
+#include "font.h"
+#include "tiles.h"
+#include "worker.h"
+
+// Sizes of cards and sub texts in a clock, plus old ones while resizing.
+#define MAX_ATLASES 16
+// All chars a card may display, digits for numbers and `APM` for ampm.
+#define ATLAS_GLYPHS "0123456789APM"
+#define ATLAS_GLYPHS_LENGTH ((int)sizeof(ATLAS_GLYPHS) - 1)
+
+struct flipclock_cache;
+struct flipclock_sdf;
+
+/**
+ * A glyph atlas keeps all glyphs of a font with a given size in one image,
+ * so drawing text is just copying sub rects and we don't need to rasterize
+ * glyphs and upload textures every time we redraw a card.
+ *
+ * Glyphs are rasterized into `surface` by a worker, and the thread that owns
+ * the renderer uploads it into `tiles` once it is done, glyphs of a huge card
+ * may not fit in one texture. For composing faces by CPU, only alpha of glyphs
+ * is kept in `coverage` and nothing is uploaded.
+ *
+ * Glyphs in cache are loaded instead of rasterized, `cached` is set for them.
+ * With a distance field, glyphs are sampled from it in `size` instead of
+ * rasterized by FreeType, and there is no font.
+ */
+struct flipclock_atlas {
+	SDL_Renderer *renderer;
+	struct flipclock_tiles *tiles;
+	SDL_Rect rects[ATLAS_GLYPHS_LENGTH];
+	struct flipclock_fonts *fonts;
+	/**
+	 * Kept until atlas is destroyed, so atlases of the same size share it
+	 * instead of opening it again, NULL if glyphs are from cache.
+	 */
+	TTF_Font *font;
+	struct flipclock_workers *workers;
+	struct flipclock_cache *cache;
+	const struct flipclock_sdf *sdf;
+	int size;
+	SDL_Color color;
+	int max_width;
+	SDL_Surface *surface;
+	bool keep_coverage;
+	Uint8 *coverage;
+	int coverage_pitch;
+	bool cached;
+	bool ready;
+	struct flipclock_job job;
+	// Cards using it, only for atlases from `flipclock_atlases`.
+	int refs;
+};
+
+/**
+ * Cards of a clock are mostly in the same size, so they share atlases opened
+ * from this registry by size and whether coverage is kept, instead of each
+ * rasterizing and uploading the same glyphs. Atlases are reference counted.
+ *
+ * Atlases belong to a renderer, so only the thread that owns the renderer uses
+ * the registry, and no locks are taken.
+ */
+struct flipclock_atlases {
+	SDL_Renderer *renderer;
+	struct flipclock_fonts *fonts;
+	struct flipclock_cache *cache;
+	// Glyphs are sampled from it instead of fonts if not NULL.
+	const struct flipclock_sdf *sdf;
+	SDL_Color color;
+	struct flipclock_workers *workers;
+	struct flipclock_atlas *atlases[MAX_ATLASES];
+	int atlases_length;
+};
+
+struct flipclock_atlas *
+flipclock_atlas_create(SDL_Renderer *renderer, struct flipclock_fonts *fonts,
+		       struct flipclock_cache *cache, int size, SDL_Color color,
+		       bool keep_coverage, struct flipclock_workers *workers);
+struct flipclock_atlas *
+flipclock_atlas_create_from_sdf(SDL_Renderer *renderer,
+				const struct flipclock_sdf *sdf, int size,
+				SDL_Color color, bool keep_coverage,
+				struct flipclock_workers *workers);
+bool flipclock_atlas_is_ready(struct flipclock_atlas *atlas);
+void flipclock_atlas_wait(struct flipclock_atlas *atlas);
+void flipclock_atlas_draw_text(struct flipclock_atlas *atlas,
+			       SDL_Rect target_rect, const char text[]);
+void flipclock_atlas_compose_text(struct flipclock_atlas *atlas,
+				  struct flipclock_canvas *canvas,
+				  SDL_Rect target_rect, const char text[]);
+SDL_Rect flipclock_atlas_get_text_rect(const struct flipclock_atlas *atlas,
+				       SDL_Rect target_rect, const char text[]);
+void flipclock_atlas_destroy(struct flipclock_atlas *atlas);
+struct flipclock_atlases *
+flipclock_atlases_create(SDL_Renderer *renderer, struct flipclock_fonts *fonts,
+			 struct flipclock_cache *cache,
+			 const struct flipclock_sdf *sdf, SDL_Color color,
+			 struct flipclock_workers *workers);
+struct flipclock_atlas *
+flipclock_atlases_open(struct flipclock_atlases *atlases, int size,
+		       bool keep_coverage);
+void flipclock_atlases_close(struct flipclock_atlases *atlases,
+			     struct flipclock_atlas *atlas);
+void flipclock_atlases_destroy(struct flipclock_atlases *atlases);
+
+#endif
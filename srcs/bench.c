@@ -0,0 +1,501 @@
+/**
+ * A headless benchmark for card and clock rendering. It uses SDL's dummy video
+ * driver (or whatever `SDL_VIDEODRIVER` says, for example `offscreen`) and the
+ * software renderer, so it runs without display and results are comparable
+ * between machines.
+ *
+ * Results are printed as JSON, debug builds also print logs to stdout, so use
+ * `-o` to write results into a file with them.
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+#include "getarg.h"
+#include "flipclock.h"
+#include "clock.h"
+#include "card.h"
+#include "atlas.h"
+#include "cache.h"
+#include "canvas.h"
+#include "font.h"
+#include "sdf.h"
+#include "worker.h"
+
+#define DEFAULT_ITERATIONS 100
+#define MAX_SIZES 8
+// Clocks have hour and minute cards, and an optional second card.
+#define MIN_CLOCK_CARDS 2
+#define MAX_CLOCK_CARDS 3
+
+struct flipclock_bench_size {
+	char name[MAX_BUFFER_LENGTH];
+	int w;
+	int h;
+};
+
+struct flipclock_bench {
+	struct flipclock *app;
+	struct flipclock_clock *clock;
+	// Only used to compare atlases, cards still use fonts.
+	struct flipclock_sdf *sdf;
+	struct flipclock_cache *cache;
+	struct flipclock_bench_size sizes[MAX_SIZES];
+	int sizes_length;
+	int cards_length;
+	int iterations;
+	double *samples;
+	FILE *output;
+	bool first_result;
+};
+
+static const struct flipclock_bench_size presets[] = {
+	{ "1080p", 1920, 1080 },
+	{ "4k", 3840, 2160 },
+	{ "8k", 7680, 4320 },
+};
+
+static int _flipclock_bench_parse_size(const char value[],
+				       struct flipclock_bench_size *size)
+{
+	RETURN_VAL_IF_FAIL(value != NULL, -1);
+	RETURN_VAL_IF_FAIL(size != NULL, -2);
+
+	for (int i = 0; i < (int)(sizeof(presets) / sizeof(presets[0])); ++i) {
+		if (!strcmp(value, presets[i].name)) {
+			*size = presets[i];
+			return 0;
+		}
+	}
+	if (sscanf(value, "%dx%d", &size->w, &size->h) != 2 || size->w <= 0 ||
+	    size->h <= 0)
+		return -3;
+	snprintf(size->name, MAX_BUFFER_LENGTH, "%dx%d", size->w, size->h);
+	return 0;
+}
+
+static void _flipclock_bench_print_help(const char program_name[])
+{
+	printf("A headless benchmark for FlipClock rendering.\n");
+	printf("Usage: %s [OPTION...]\n", program_name);
+	printf("Options:\n");
+	printf("\t%ch\t\tDisplay this help.\n", OPT_START);
+	printf("\t%cr <size>\tAdd a window size, `1080p`, `4k`, `8k` or "
+	       "`WxH`,\n\t\t\tcan be used multiple times, defaults to all "
+	       "presets.\n",
+	       OPT_START);
+	printf("\t%cc <cards>\tCards in a clock, `2` or `3`, defaults to "
+	       "`3`.\n",
+	       OPT_START);
+	printf("\t%cn <count>\tIterations for each benchmark, defaults to "
+	       "`%d`.\n",
+	       OPT_START, DEFAULT_ITERATIONS);
+	printf("\t%cw <workers>\tWorker threads for glyphs and composing "
+	       "faces,\n\t\t\tdefaults to `0` that uses no workers.\n",
+	       OPT_START);
+	printf("\t%cf <font>\tFont path.\n", OPT_START);
+	printf("\t%co <file>\tWrite results into file instead of stdout.\n",
+	       OPT_START);
+}
+
+static double _flipclock_bench_get_us(Uint64 start, Uint64 end)
+{
+	return (double)(end - start) * 1000000.0 /
+	       SDL_GetPerformanceFrequency();
+}
+
+static int _flipclock_bench_compare(const void *a, const void *b)
+{
+	const double x = *(const double *)a;
+	const double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile, samples must be sorted.
+static double _flipclock_bench_get_percentile(const double samples[],
+					      int length, double percentile)
+{
+	RETURN_VAL_IF_FAIL(samples != NULL, 0);
+	RETURN_VAL_IF_FAIL(length > 0, 0);
+
+	int rank = ceil(percentile / 100 * length);
+	if (rank < 1)
+		rank = 1;
+	return samples[rank - 1];
+}
+
+static void _flipclock_bench_report(struct flipclock_bench *bench,
+				    const struct flipclock_bench_size *size,
+				    const char name[])
+{
+	RETURN_IF_FAIL(bench != NULL);
+	RETURN_IF_FAIL(size != NULL);
+	RETURN_IF_FAIL(name != NULL);
+
+	const int length = bench->iterations;
+	double sum = 0;
+	for (int i = 0; i < length; ++i)
+		sum += bench->samples[i];
+	qsort(bench->samples, length, sizeof(*bench->samples),
+	      _flipclock_bench_compare);
+	fprintf(bench->output,
+		"%s\n\t\t{ \"size\": \"%s\", \"w\": %d, \"h\": %d, "
+		"\"cards\": %d, \"name\": \"%s\", \"unit\": \"us\", "
+		"\"min\": %.1f, \"p50\": %.1f, \"p90\": %.1f, "
+		"\"p99\": %.1f, \"max\": %.1f, \"mean\": %.1f }",
+		bench->first_result ? "" : ",", size->name, size->w, size->h,
+		bench->cards_length, name, bench->samples[0],
+		_flipclock_bench_get_percentile(bench->samples, length, 50),
+		_flipclock_bench_get_percentile(bench->samples, length, 90),
+		_flipclock_bench_get_percentile(bench->samples, length, 99),
+		bench->samples[length - 1], sum / length);
+	bench->first_result = false;
+}
+
+// Dispatch messages and render until clock has nothing to do.
+static void _flipclock_bench_settle(struct flipclock_bench *bench)
+{
+	RETURN_IF_FAIL(bench != NULL);
+
+	flipclock_clock_animate(bench->clock);
+	// Faces are only redrawn for new size after resizing is settled.
+	while (bench->clock->resizing ||
+	       flipclock_clock_is_animating(bench->clock)) {
+		SDL_Delay(10);
+		flipclock_clock_animate(bench->clock);
+	}
+}
+
+static void _flipclock_bench_resize(struct flipclock_bench *bench,
+				    const struct flipclock_bench_size *size)
+{
+	RETURN_IF_FAIL(bench != NULL);
+	RETURN_IF_FAIL(size != NULL);
+
+	SDL_SetWindowSize(bench->clock->window, size->w, size->h);
+	SDL_Event event;
+	memset(&event, 0, sizeof(event));
+	event.type = SDL_WINDOWEVENT;
+	event.window.event = SDL_WINDOWEVENT_SIZE_CHANGED;
+	flipclock_clock_handle_window_event(bench->clock, event);
+	_flipclock_bench_settle(bench);
+}
+
+// Make card display a flip at given progress on next animation.
+static void _flipclock_bench_set_progress(struct flipclock_card *card,
+					  int progress)
+{
+	RETURN_IF_FAIL(card != NULL);
+
+	card->flipping = true;
+	card->start_tick = SDL_GetTicks() - progress;
+}
+
+static void _flipclock_bench_run_size(struct flipclock_bench *bench,
+				      const struct flipclock_bench_size *size)
+{
+	RETURN_IF_FAIL(bench != NULL);
+	RETURN_IF_FAIL(size != NULL);
+
+	struct flipclock_clock *clock = bench->clock;
+	SDL_Renderer *renderer = clock->renderer;
+	_flipclock_bench_resize(bench, size);
+	int w;
+	int h;
+	SDL_GetRendererOutputSize(renderer, &w, &h);
+	if (w != size->w || h != size->h)
+		LOG_ERROR("Window size is `%dx%d` instead of `%dx%d`.\n", w, h,
+			  size->w, size->h);
+
+	// Minute card has no sub text, so it is the common case.
+	struct flipclock_card *card = clock->cards[FLIPCLOCK_CARD_MINUTE];
+	flipclock_clock_set_text(clock, FLIPCLOCK_CARD_HOUR, "12", false);
+	flipclock_clock_set_text(clock, FLIPCLOCK_CARD_MINUTE, "58", false);
+	if (clock->show_second)
+		flipclock_clock_set_text(clock, FLIPCLOCK_CARD_SECOND, "58",
+					 false);
+	_flipclock_bench_settle(bench);
+	Uint64 start;
+	char name[MAX_BUFFER_LENGTH];
+
+	// Compare drawing faces with renderer and composing them by CPU.
+	const bool cpu_compose = card->cpu_compose;
+	for (int j = 0; j < 2; ++j) {
+		flipclock_card_set_cpu_compose(card, j == 1);
+		_flipclock_bench_settle(bench);
+		for (int i = 0; i < bench->iterations; ++i) {
+			start = SDL_GetPerformanceCounter();
+			flipclock_card_draw(card, card->current);
+			SDL_RenderFlush(renderer);
+			bench->samples[i] = _flipclock_bench_get_us(
+				start, SDL_GetPerformanceCounter());
+		}
+		_flipclock_bench_report(bench, size,
+					j == 1 ? "card_draw_cpu" : "card_draw");
+	}
+	flipclock_card_set_cpu_compose(card, cpu_compose);
+	_flipclock_bench_settle(bench);
+
+	/**
+	 * Compare atlases for a new card size, FreeType needs to open font in
+	 * the new size and rasterize glyphs, cache only reads them from a file,
+	 * and distance field is only sampled. Cards don't keep fonts, so it is
+	 * opened for every atlas.
+	 */
+	struct flipclock *app = bench->app;
+	const int font_size = card->rect.h * app->text_scale;
+	const char *atlas_names[] = { "atlas_font", "atlas_cache",
+				      "atlas_sdf" };
+	for (int j = 0; j < 3; ++j) {
+		// Not every platform has a cache.
+		if (j == 1 && bench->cache == NULL)
+			continue;
+		// Write the file before measuring.
+		if (j == 1)
+			flipclock_atlas_destroy(flipclock_atlas_create(
+				renderer, app->fonts, bench->cache, font_size,
+				app->text_color, card->cpu_compose, NULL));
+		for (int i = 0; i < bench->iterations; ++i) {
+			struct flipclock_atlas *atlas;
+			start = SDL_GetPerformanceCounter();
+			if (j == 2)
+				atlas = flipclock_atlas_create_from_sdf(
+					renderer, bench->sdf, font_size,
+					app->text_color, card->cpu_compose,
+					NULL);
+			else
+				atlas = flipclock_atlas_create(
+					renderer, app->fonts,
+					j == 1 ? bench->cache : NULL,
+					font_size, app->text_color,
+					card->cpu_compose, NULL);
+			flipclock_atlas_wait(atlas);
+			bench->samples[i] = _flipclock_bench_get_us(
+				start, SDL_GetPerformanceCounter());
+			flipclock_atlas_destroy(atlas);
+		}
+		_flipclock_bench_report(bench, size, atlas_names[j]);
+	}
+
+	// Let card have a previous face for flipping.
+	flipclock_clock_set_text(clock, FLIPCLOCK_CARD_MINUTE, "59", true);
+	_flipclock_bench_settle(bench);
+
+	for (int progress = 0; progress < MAX_PROGRESS;
+	     progress += MAX_PROGRESS / 4) {
+		for (int i = 0; i < bench->iterations; ++i) {
+			_flipclock_bench_set_progress(card, progress);
+			start = SDL_GetPerformanceCounter();
+			flipclock_card_animate(card);
+			SDL_RenderFlush(renderer);
+			bench->samples[i] = _flipclock_bench_get_us(
+				start, SDL_GetPerformanceCounter());
+		}
+		snprintf(name, MAX_BUFFER_LENGTH, "card_animate_%d",
+			 progress * 100 / MAX_PROGRESS);
+		_flipclock_bench_report(bench, size, name);
+	}
+	card->flipping = false;
+
+	for (int i = 0; i < bench->iterations; ++i) {
+		clock->dirty = true;
+		start = SDL_GetPerformanceCounter();
+		flipclock_clock_animate(clock);
+		bench->samples[i] = _flipclock_bench_get_us(
+			start, SDL_GetPerformanceCounter());
+	}
+	_flipclock_bench_report(bench, size, "clock_frame_idle");
+
+	for (int i = 0; i < bench->iterations; ++i) {
+		_flipclock_bench_set_progress(card, HALF_PROGRESS);
+		start = SDL_GetPerformanceCounter();
+		flipclock_clock_animate(clock);
+		bench->samples[i] = _flipclock_bench_get_us(
+			start, SDL_GetPerformanceCounter());
+	}
+	_flipclock_bench_report(bench, size, "clock_frame_flip");
+	card->flipping = false;
+
+	// Changing height makes card reopen fonts and redraw faces every time.
+	const SDL_Rect rect = card->rect;
+	SDL_Rect other_rect = rect;
+	other_rect.h = rect.h > 2 ? rect.h - 2 : rect.h + 2;
+	for (int i = 0; i < bench->iterations; ++i) {
+		start = SDL_GetPerformanceCounter();
+		flipclock_card_set_rect(card, i % 2 ? rect : other_rect);
+		flipclock_card_animate(card);
+		SDL_RenderFlush(renderer);
+		bench->samples[i] = _flipclock_bench_get_us(
+			start, SDL_GetPerformanceCounter());
+	}
+	_flipclock_bench_report(bench, size, "card_set_rect");
+	flipclock_card_set_rect(card, rect);
+	_flipclock_bench_settle(bench);
+}
+
+int main(int argc, char *argv[])
+{
+	struct flipclock_bench bench;
+	bench.sizes_length = 0;
+	bench.cards_length = MAX_CLOCK_CARDS;
+	bench.iterations = DEFAULT_ITERATIONS;
+	bench.output = stdout;
+	bench.first_result = true;
+	int worker_threads = 0;
+	char font_path[MAX_BUFFER_LENGTH] = "";
+	char output_path[MAX_BUFFER_LENGTH] = "";
+
+	char OPT_STRING[] = "hr:c:n:w:f:o:";
+	int opt = 0;
+	while ((opt = getarg(argc, argv, OPT_STRING)) != -1) {
+		// All options except help need a value.
+		if (opt != 'h' && opt != 0 && strchr(OPT_STRING, opt) != NULL &&
+		    argopt == NULL) {
+			LOG_ERROR("Missing value for option `%c%c`\n",
+				  OPT_START, opt);
+			exit(EXIT_FAILURE);
+		}
+		switch (opt) {
+		case 'h':
+			_flipclock_bench_print_help(argv[0]);
+			exit(EXIT_SUCCESS);
+			break;
+		case 'r':
+			if (bench.sizes_length == MAX_SIZES) {
+				LOG_ERROR("Too many sizes!\n");
+				exit(EXIT_FAILURE);
+			}
+			if (_flipclock_bench_parse_size(
+				    argopt, &bench.sizes[bench.sizes_length]) <
+			    0) {
+				LOG_ERROR("Invalid size `%s`.\n", argopt);
+				exit(EXIT_FAILURE);
+			}
+			++bench.sizes_length;
+			break;
+		case 'c':
+			bench.cards_length = atoi(argopt);
+			if (bench.cards_length < MIN_CLOCK_CARDS ||
+			    bench.cards_length > MAX_CLOCK_CARDS) {
+				LOG_ERROR("Cards should be `%d` or `%d`.\n",
+					  MIN_CLOCK_CARDS, MAX_CLOCK_CARDS);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'n':
+			bench.iterations = atoi(argopt);
+			if (bench.iterations <= 0) {
+				LOG_ERROR("Invalid iterations `%s`.\n", argopt);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'w':
+			worker_threads = atoi(argopt);
+			if (worker_threads < 0) {
+				LOG_ERROR("Invalid workers `%s`.\n", argopt);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'f':
+			strncpy(font_path, argopt, MAX_BUFFER_LENGTH);
+			font_path[MAX_BUFFER_LENGTH - 1] = '\0';
+			break;
+		case 'o':
+			strncpy(output_path, argopt, MAX_BUFFER_LENGTH);
+			output_path[MAX_BUFFER_LENGTH - 1] = '\0';
+			break;
+		case 0:
+			LOG_ERROR("%s: Invalid value `%s`.\n", argv[0], argopt);
+			exit(EXIT_FAILURE);
+			break;
+		default:
+			LOG_ERROR("%s: Invalid option `%c%c`.\n", argv[0],
+				  OPT_START, opt);
+			exit(EXIT_FAILURE);
+			break;
+		}
+	}
+	if (bench.sizes_length == 0) {
+		bench.sizes_length = sizeof(presets) / sizeof(presets[0]);
+		for (int i = 0; i < bench.sizes_length; ++i)
+			bench.sizes[i] = presets[i];
+	}
+	bench.samples = malloc(bench.iterations * sizeof(*bench.samples));
+	if (bench.samples == NULL) {
+		LOG_ERROR("Failed to allocate samples!\n");
+		exit(EXIT_FAILURE);
+	}
+	if (output_path[0] != '\0') {
+		bench.output = fopen(output_path, "w");
+		if (bench.output == NULL) {
+			LOG_ERROR("Failed to open `%s`!\n", output_path);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// Don't override drivers chosen by users.
+	SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+	SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+		LOG_ERROR("%s\n", SDL_GetError());
+		exit(EXIT_FAILURE);
+	}
+	if (TTF_Init() < 0) {
+		LOG_ERROR("%s\n", TTF_GetError());
+		exit(EXIT_FAILURE);
+	}
+
+	bench.app = flipclock_create();
+	struct flipclock *app = bench.app;
+	if (font_path[0] != '\0')
+		strncpy(app->font_path, font_path, MAX_BUFFER_LENGTH);
+	app->full = false;
+	app->show_second = bench.cards_length == MAX_CLOCK_CARDS;
+	// Benchmark measures rendering, so do it in this thread.
+	app->render_threads = false;
+	app->fonts = flipclock_fonts_create(app->font_path);
+	// Results are the same with any workers, only time changes.
+	if (worker_threads > 0)
+		app->workers = flipclock_workers_create(worker_threads);
+	bench.clock = flipclock_clock_create(app, 0);
+	bench.sdf = flipclock_sdf_create(app->fonts);
+	bench.cache = flipclock_cache_create(
+		app->fonts->data, app->fonts->data_size, app->text_scale);
+
+	SDL_RendererInfo info;
+	SDL_GetRendererInfo(bench.clock->renderer, &info);
+	fprintf(bench.output,
+		"{\n\t\"version\": \"%s\",\n\t\"video_driver\": \"%s\",\n"
+		"\t\"renderer\": \"%s\",\n\t\"canvas_kernel\": \"%s\",\n"
+		"\t\"workers\": %d,\n\t\"iterations\": %d,\n"
+		"\t\"results\": [",
+		PROJECT_VERSION, SDL_GetCurrentVideoDriver(), info.name,
+		flipclock_canvas_get_kernel_name(),
+		app->workers != NULL ? app->workers->threads_length : 0,
+		bench.iterations);
+	for (int i = 0; i < bench.sizes_length; ++i)
+		_flipclock_bench_run_size(&bench, &bench.sizes[i]);
+	fprintf(bench.output, "\n\t]\n}\n");
+
+	flipclock_clock_destroy(bench.clock);
+	flipclock_sdf_destroy(bench.sdf);
+	if (bench.cache != NULL)
+		flipclock_cache_destroy(bench.cache);
+	if (app->workers != NULL) {
+		flipclock_workers_destroy(app->workers);
+		app->workers = NULL;
+	}
+	flipclock_fonts_destroy(app->fonts);
+	app->fonts = NULL;
+	flipclock_destroy(app);
+	if (bench.output != stdout)
+		fclose(bench.output);
+	free(bench.samples);
+	TTF_Quit();
+	SDL_Quit();
+	return 0;
+}
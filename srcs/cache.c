@@ -0,0 +1,379 @@
+// We need `futimens()` with `-std=c11`.
+#if !defined(_WIN32)
+#	define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipclock.h"
+#include "cache.h"
+#include "trace.h"
+
+/**
+ * Only Linux has a standard cache dir, Android APP data may be cleared by
+ * users and Windows screensavers have no place to write.
+ */
+#if defined(__linux__) && !defined(__ANDROID__)
+#	define HAVE_CACHE
+#	include <dirent.h>
+#	include <errno.h>
+#	include <fcntl.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#define CACHE_MAGIC "FCATLAS"
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+#if defined(HAVE_CACHE)
+struct flipclock_cache_file {
+	char name[256];
+	time_t mtime;
+};
+
+// FNV-1a, it is fast enough for a font file and we don't need security.
+static Uint64 _flipclock_cache_hash(const void *data, size_t size)
+{
+	const Uint8 *bytes = data;
+	Uint64 hash = FNV_OFFSET_BASIS;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+static bool _flipclock_cache_make_dir(const char path[])
+{
+	RETURN_VAL_IF_FAIL(path != NULL, false);
+
+	return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+static bool _flipclock_cache_get_dir(char dir[])
+{
+	RETURN_VAL_IF_FAIL(dir != NULL, false);
+
+	char base[MAX_BUFFER_LENGTH];
+	const char *cache_dir = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+	int length;
+	if (cache_dir != NULL && strlen(cache_dir) != 0)
+		length = snprintf(base, MAX_BUFFER_LENGTH, "%s", cache_dir);
+	else if (home != NULL && strlen(home) != 0)
+		length = snprintf(base, MAX_BUFFER_LENGTH, "%s/.cache", home);
+	else
+		return false;
+	if (length >= 0 && length < MAX_BUFFER_LENGTH)
+		length = snprintf(dir, MAX_BUFFER_LENGTH, "%s/flipclock", base);
+	// Leave space for file names, so paths of files are never truncated.
+	if (length < 0 || length >= MAX_BUFFER_LENGTH - MAX_CACHE_NAME_LENGTH) {
+		LOG_ERROR("`cache_dir` too long, cache is disabled.\n");
+		return false;
+	}
+	return _flipclock_cache_make_dir(base) &&
+	       _flipclock_cache_make_dir(dir);
+}
+
+static int _flipclock_cache_compare_files(const void *a, const void *b)
+{
+	const struct flipclock_cache_file *file_a = a;
+	const struct flipclock_cache_file *file_b = b;
+	// Newest first.
+	if (file_a->mtime != file_b->mtime)
+		return file_a->mtime < file_b->mtime ? 1 : -1;
+	return strcmp(file_a->name, file_b->name);
+}
+
+/**
+ * Every card size gets a file, so sizes used by resizing windows would fill
+ * the dir. Keep recently used files, loading a file touches it.
+ */
+static void _flipclock_cache_prune(struct flipclock_cache *cache)
+{
+	RETURN_IF_FAIL(cache != NULL);
+
+	DIR *dir = opendir(cache->dir);
+	if (dir == NULL)
+		return;
+	struct flipclock_cache_file *files = NULL;
+	int files_length = 0;
+	int files_capacity = 0;
+	struct dirent *entry;
+	const time_t now = time(NULL);
+	while ((entry = readdir(dir)) != NULL) {
+		const size_t length = strlen(entry->d_name);
+		const bool temp =
+			length >= 4 &&
+			strcmp(entry->d_name + length - 4, ".tmp") == 0;
+		const bool atlas =
+			length >= 6 && length < sizeof(files->name) &&
+			strcmp(entry->d_name + length - 6, ".atlas") == 0;
+		if (!temp && !atlas)
+			continue;
+		struct stat st;
+		if (fstatat(dirfd(dir), entry->d_name, &st, 0) < 0)
+			continue;
+		/**
+		 * Writers that crashed leave temporary files, but another
+		 * process may be writing a new one, so only remove old ones.
+		 */
+		if (temp) {
+			if (now - st.st_mtime > CACHE_TEMP_AGE) {
+				LOG_DEBUG("Removing temporary file `%s`.\n",
+					  entry->d_name);
+				unlinkat(dirfd(dir), entry->d_name, 0);
+			}
+			continue;
+		}
+		if (files_length == files_capacity) {
+			files_capacity = files_capacity * 2 + 16;
+			struct flipclock_cache_file *new_files = realloc(
+				files, files_capacity * sizeof(*files));
+			if (new_files == NULL)
+				break;
+			files = new_files;
+		}
+		strcpy(files[files_length].name, entry->d_name);
+		files[files_length].mtime = st.st_mtime;
+		++files_length;
+	}
+	if (files_length > MAX_CACHE_FILES) {
+		qsort(files, files_length, sizeof(*files),
+		      _flipclock_cache_compare_files);
+		for (int i = MAX_CACHE_FILES; i < files_length; ++i) {
+			LOG_DEBUG("Removing cached atlas `%s`.\n",
+				  files[i].name);
+			unlinkat(dirfd(dir), files[i].name, 0);
+		}
+	}
+	free(files);
+	closedir(dir);
+}
+
+// Returns false if path is too long, the file is not used then.
+static bool _flipclock_cache_get_path(const struct flipclock_cache *cache,
+				      int size, Uint8 alpha, char path[])
+{
+	const int length =
+		snprintf(path, MAX_BUFFER_LENGTH, "%s/%016llx-%d-%d-%02x.atlas",
+			 cache->dir, (unsigned long long)cache->font_hash, size,
+			 (int)(cache->text_scale * 1000), alpha);
+	return length >= 0 && length < MAX_BUFFER_LENGTH;
+}
+
+// Returns false if file is shorter than length.
+static bool _flipclock_cache_read(int fd, void *buffer, size_t length)
+{
+	Uint8 *bytes = buffer;
+	while (length > 0) {
+		const ssize_t result = read(fd, bytes, length);
+		if (result < 0 && errno == EINTR)
+			continue;
+		if (result <= 0)
+			return false;
+		bytes += result;
+		length -= result;
+	}
+	return true;
+}
+
+static bool _flipclock_cache_rect_is_inside(const Sint32 rect[4], int width,
+					    int height)
+{
+	return rect[0] >= 0 && rect[1] >= 0 && rect[2] >= 0 && rect[3] >= 0 &&
+	       rect[0] <= width - rect[2] && rect[1] <= height - rect[3];
+}
+
+static void
+_flipclock_cache_init_header(const struct flipclock_cache *cache, int size,
+			     Uint8 alpha, int width, int height,
+			     struct flipclock_cache_header *header)
+{
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header->version = CACHE_VERSION;
+	header->glyphs_length = ATLAS_GLYPHS_LENGTH;
+	header->font_hash = cache->font_hash;
+	header->size = size;
+	header->scale = cache->text_scale * 1000;
+	header->alpha = alpha;
+	header->width = width;
+	header->height = height;
+}
+#endif
+
+/**
+ * Returns NULL if this platform has no cache dir or we cannot create it, so
+ * callers just rasterize glyphs by FreeType.
+ */
+struct flipclock_cache *flipclock_cache_create(const void *font_data,
+					       size_t font_size,
+					       double text_scale)
+{
+	RETURN_VAL_IF_FAIL(font_data != NULL, NULL);
+
+#if defined(HAVE_CACHE)
+	const Uint64 trace_start = flipclock_trace_begin();
+	struct flipclock_cache *cache = malloc(sizeof(*cache));
+	if (cache == NULL) {
+		LOG_ERROR("Failed to create cache!\n");
+		exit(EXIT_FAILURE);
+	}
+	if (!_flipclock_cache_get_dir(cache->dir)) {
+		LOG_ERROR("Failed to create cache dir, cache is disabled.\n");
+		free(cache);
+		return NULL;
+	}
+	LOG_DEBUG("Using `cache_dir` `%s`.\n", cache->dir);
+	cache->font_hash = _flipclock_cache_hash(font_data, font_size);
+	cache->text_scale = text_scale;
+	SDL_AtomicSet(&cache->stores, 0);
+	_flipclock_cache_prune(cache);
+	flipclock_trace_end(__func__, trace_start);
+	return cache;
+#else
+	(void)font_size;
+	(void)text_scale;
+	return NULL;
+#endif
+}
+
+/**
+ * Returns false on a miss or a broken file. Otherwise `rects` and sizes are
+ * set, and `coverage` must be freed by caller.
+ */
+bool flipclock_cache_load_atlas(struct flipclock_cache *cache, int size,
+				Uint8 alpha, SDL_Rect rects[], Uint8 **coverage,
+				int *width, int *height)
+{
+	RETURN_VAL_IF_FAIL(cache != NULL, false);
+	RETURN_VAL_IF_FAIL(rects != NULL, false);
+	RETURN_VAL_IF_FAIL(coverage != NULL, false);
+	RETURN_VAL_IF_FAIL(width != NULL, false);
+	RETURN_VAL_IF_FAIL(height != NULL, false);
+
+#if defined(HAVE_CACHE)
+	char path[MAX_BUFFER_LENGTH];
+	if (!_flipclock_cache_get_path(cache, size, alpha, path))
+		return false;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	// Keep recently used files when pruning.
+	futimens(fd, NULL);
+	struct stat st;
+	struct flipclock_cache_header header;
+	struct flipclock_cache_header expected;
+	bool valid = fstat(fd, &st) == 0 &&
+		     _flipclock_cache_read(fd, &header, sizeof(header));
+	if (valid) {
+		_flipclock_cache_init_header(cache, size, alpha, header.width,
+					     header.height, &expected);
+		valid = memcmp(&header, &expected,
+			       offsetof(struct flipclock_cache_header,
+					rects)) == 0 &&
+			header.width > 0 && header.height > 0 &&
+			(size_t)st.st_size ==
+				sizeof(header) +
+					(size_t)header.width * header.height;
+	}
+	// Glyphs are copied by rects, so they must be inside coverage.
+	for (int i = 0; valid && i < ATLAS_GLYPHS_LENGTH; ++i)
+		valid = _flipclock_cache_rect_is_inside(
+			header.rects[i], header.width, header.height);
+	Uint8 *data = NULL;
+	if (valid) {
+		const size_t length = (size_t)header.width * header.height;
+		data = malloc(length);
+		if (data == NULL) {
+			LOG_ERROR("Failed to create atlas coverage!\n");
+			exit(EXIT_FAILURE);
+		}
+		valid = _flipclock_cache_read(fd, data, length);
+	}
+	close(fd);
+	if (!valid) {
+		LOG_ERROR("Ignoring broken cached atlas `%s`.\n", path);
+		free(data);
+		return false;
+	}
+	*width = header.width;
+	*height = header.height;
+	for (int i = 0; i < ATLAS_GLYPHS_LENGTH; ++i) {
+		rects[i].x = header.rects[i][0];
+		rects[i].y = header.rects[i][1];
+		rects[i].w = header.rects[i][2];
+		rects[i].h = header.rects[i][3];
+	}
+	*coverage = data;
+	return true;
+#else
+	(void)size;
+	(void)alpha;
+	return false;
+#endif
+}
+
+/**
+ * Failing to write is not an error, we can rasterize glyphs next time. It is
+ * called by workers, so it only touches its own files.
+ */
+void flipclock_cache_store_atlas(struct flipclock_cache *cache, int size,
+				 Uint8 alpha, const SDL_Rect rects[],
+				 const Uint8 coverage[], int width, int height)
+{
+	RETURN_IF_FAIL(cache != NULL);
+	RETURN_IF_FAIL(rects != NULL);
+	RETURN_IF_FAIL(coverage != NULL);
+
+#if defined(HAVE_CACHE)
+	if (SDL_AtomicAdd(&cache->stores, 1) >= MAX_CACHE_FILES)
+		return;
+	struct flipclock_cache_header header;
+	_flipclock_cache_init_header(cache, size, alpha, width, height,
+				     &header);
+	for (int i = 0; i < ATLAS_GLYPHS_LENGTH; ++i) {
+		header.rects[i][0] = rects[i].x;
+		header.rects[i][1] = rects[i].y;
+		header.rects[i][2] = rects[i].w;
+		header.rects[i][3] = rects[i].h;
+	}
+	char path[MAX_BUFFER_LENGTH];
+	char temp_path[MAX_BUFFER_LENGTH + 32];
+	if (!_flipclock_cache_get_path(cache, size, alpha, path))
+		return;
+	// Different processes and workers never share a temporary file.
+	const int temp_length = snprintf(temp_path, sizeof(temp_path),
+					 "%s.%ld.%lu.tmp", path,
+					 (long)getpid(),
+					 (unsigned long)SDL_ThreadID());
+	if (temp_length < 0 || temp_length >= (int)sizeof(temp_path))
+		return;
+	FILE *file = fopen(temp_path, "wb");
+	if (file == NULL)
+		return;
+	const size_t length = (size_t)width * height;
+	const bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			     fwrite(coverage, 1, length, file) == length;
+	if (fclose(file) != 0 || !written || rename(temp_path, path) != 0) {
+		LOG_ERROR("Failed to write cached atlas `%s`.\n", path);
+		remove(temp_path);
+		return;
+	}
+	LOG_DEBUG("Wrote cached atlas `%s`.\n", path);
+#else
+	(void)size;
+	(void)alpha;
+	(void)width;
+	(void)height;
+#endif
+}
+
+void flipclock_cache_destroy(struct flipclock_cache *cache)
+{
+	RETURN_IF_FAIL(cache != NULL);
+
+	free(cache);
+}
@@ -0,0 +1,68 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <SDL.h>
+
+#include "atlas.h"
+#include "flipclock.h"
+
+// Bump it when layout of files or glyphs in atlas changed.
+#define CACHE_VERSION 1
+// Older files are removed on start, and a run won't write more than it.
+#define MAX_CACHE_FILES 32
+// Longest name of temporary files with `/`, names of files are shorter.
+#define MAX_CACHE_NAME_LENGTH 96
+// Seconds before a temporary file is considered left by a crashed writer.
+#define CACHE_TEMP_AGE 3600
+
+/**
+ * Cache file is a header followed by alpha of all glyphs in an atlas, one
+ * byte per pixel with `width` as pitch. All fields are in native byte order,
+ * because it is only used on the machine that wrote it.
+ */
+struct flipclock_cache_header {
+	char magic[8];
+	Uint32 version;
+	Uint32 glyphs_length;
+	Uint64 font_hash;
+	Sint32 size;
+	// `text_scale` in thousandths.
+	Sint32 scale;
+	Uint32 alpha;
+	Sint32 width;
+	Sint32 height;
+	Sint32 rects[ATLAS_GLYPHS_LENGTH][4];
+};
+
+/**
+ * Rasterized atlases are kept in `$XDG_CACHE_HOME/flipclock/`, so next start
+ * can read them instead of opening fonts with FreeType. Files are named by
+ * hash of font file, pixel size, `text_scale` and alpha of text color, a
+ * changed font gets new files.
+ *
+ * Files are written into temporary files and renamed, so another process
+ * reading them never sees half of a file, and it is safe to use a cache from
+ * different workers.
+ */
+struct flipclock_cache {
+	char dir[MAX_BUFFER_LENGTH];
+	Uint64 font_hash;
+	double text_scale;
+	SDL_atomic_t stores;
+};
+
+struct flipclock_cache *flipclock_cache_create(const void *font_data,
+					       size_t font_size,
+					       double text_scale);
+bool flipclock_cache_load_atlas(struct flipclock_cache *cache, int size,
+				Uint8 alpha, SDL_Rect rects[], Uint8 **coverage,
+				int *width, int *height);
+void flipclock_cache_store_atlas(struct flipclock_cache *cache, int size,
+				 Uint8 alpha, const SDL_Rect rects[],
+				 const Uint8 coverage[], int width, int height);
+void flipclock_cache_destroy(struct flipclock_cache *cache);
+
+#endif
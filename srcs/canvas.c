@@ -0,0 +1,407 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "flipclock.h"
+#include "canvas.h"
+
+/**
+ * SSE2 and AVX2 kernels are selected when running, NEON is always available
+ * on the platforms we build for it.
+ */
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+	defined(_M_IX86)
+#	define HAVE_SSE2
+#	define HAVE_AVX2
+#	include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#	define HAVE_NEON
+#	include <arm_neon.h>
+#endif
+
+// Let compiler generate instructions only for the kernel that uses them.
+#if defined(__GNUC__)
+#	define TARGET(x) __attribute__((target(x)))
+#else
+#	define TARGET(x)
+#endif
+
+/**
+ * Exactly rounded `x / 255` for `x <= 255 * 255`, all kernels use the same
+ * integer math so they give the same pixels.
+ */
+static inline Uint32 _flipclock_canvas_div255(Uint32 x)
+{
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+/**
+ * Same as `SDL_BLENDMODE_BLEND`, source is color with mask as coverage:
+ * `dst = src * a + dst * (1 - a)` for colors and `a + dst * (1 - a)` for
+ * alpha, the latter is written as color 255 so all channels share one path.
+ */
+static void _flipclock_canvas_blend_row_c(Uint32 *dst, const Uint8 *mask,
+					  int length, SDL_Color color)
+{
+	for (int i = 0; i < length; ++i) {
+		const Uint32 a = _flipclock_canvas_div255(mask[i] * color.a);
+		if (a == 0)
+			continue;
+		const Uint32 d = dst[i];
+		const Uint32 ia = 255 - a;
+		const Uint32 b =
+			_flipclock_canvas_div255(color.b * a + (d & 0xff) * ia);
+		const Uint32 g = _flipclock_canvas_div255(
+			color.g * a + ((d >> 8) & 0xff) * ia);
+		const Uint32 r = _flipclock_canvas_div255(
+			color.r * a + ((d >> 16) & 0xff) * ia);
+		const Uint32 alpha =
+			_flipclock_canvas_div255(255 * a + (d >> 24) * ia);
+		dst[i] = (alpha << 24) | (r << 16) | (g << 8) | b;
+	}
+}
+
+#if defined(HAVE_SSE2)
+TARGET("sse2")
+static inline __m128i _flipclock_canvas_div255_sse2(__m128i x)
+{
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Two pixels in 16-bit lanes.
+TARGET("sse2")
+static inline __m128i _flipclock_canvas_blend_sse2(__m128i src, __m128i dst,
+						   __m128i a)
+{
+	const __m128i ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+	return _flipclock_canvas_div255_sse2(_mm_add_epi16(
+		_mm_mullo_epi16(src, a), _mm_mullo_epi16(dst, ia)));
+}
+
+TARGET("sse2")
+static void _flipclock_canvas_blend_row_sse2(Uint32 *dst, const Uint8 *mask,
+					     int length, SDL_Color color)
+{
+	const __m128i zero = _mm_setzero_si128();
+	// Byte order of ARGB8888 in memory is BGRA on little endian.
+	const __m128i src = _mm_set_epi16(255, color.r, color.g, color.b, 255,
+					  color.r, color.g, color.b);
+	const __m128i color_a = _mm_set1_epi16(color.a);
+	int i = 0;
+	for (; i + 4 <= length; i += 4) {
+		Uint32 m;
+		memcpy(&m, mask + i, sizeof(m));
+		// Most pixels are outside glyphs.
+		if (m == 0)
+			continue;
+		__m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(m), zero);
+		a = _flipclock_canvas_div255_sse2(_mm_mullo_epi16(a, color_a));
+		// Repeat alpha of each pixel for its 4 channels.
+		a = _mm_unpacklo_epi16(a, a);
+		const __m128i a_lo = _mm_unpacklo_epi32(a, a);
+		const __m128i a_hi = _mm_unpackhi_epi32(a, a);
+		const __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+		const __m128i lo = _flipclock_canvas_blend_sse2(
+			src, _mm_unpacklo_epi8(d, zero), a_lo);
+		const __m128i hi = _flipclock_canvas_blend_sse2(
+			src, _mm_unpackhi_epi8(d, zero), a_hi);
+		_mm_storeu_si128((__m128i *)(dst + i),
+				 _mm_packus_epi16(lo, hi));
+	}
+	_flipclock_canvas_blend_row_c(dst + i, mask + i, length - i, color);
+}
+#endif
+
+#if defined(HAVE_AVX2)
+TARGET("avx2")
+static inline __m256i _flipclock_canvas_div255_avx2(__m256i x)
+{
+	x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)),
+				 8);
+}
+
+TARGET("avx2")
+static inline __m256i _flipclock_canvas_blend_avx2(__m256i src, __m256i dst,
+						   __m256i a)
+{
+	const __m256i ia = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+	return _flipclock_canvas_div255_avx2(_mm256_add_epi16(
+		_mm256_mullo_epi16(src, a), _mm256_mullo_epi16(dst, ia)));
+}
+
+/**
+ * Unpacking works inside 128-bit lanes, so 8 pixels are split as 0, 1, 4, 5
+ * and 2, 3, 6, 7, alpha is arranged in the same way.
+ */
+TARGET("avx2")
+static void _flipclock_canvas_blend_row_avx2(Uint32 *dst, const Uint8 *mask,
+					     int length, SDL_Color color)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i src = _mm256_setr_epi16(
+		color.b, color.g, color.r, 255, color.b, color.g, color.r, 255,
+		color.b, color.g, color.r, 255, color.b, color.g, color.r, 255);
+	const __m128i color_a = _mm_set1_epi16(color.a);
+	int i = 0;
+	for (; i + 8 <= length; i += 8) {
+		Uint64 bits;
+		memcpy(&bits, mask + i, sizeof(bits));
+		if (bits == 0)
+			continue;
+		const __m128i m = _mm_loadl_epi64((const __m128i *)(mask + i));
+		__m128i a = _mm_unpacklo_epi8(m, _mm_setzero_si128());
+		a = _mm_mullo_epi16(a, color_a);
+		a = _mm_add_epi16(a, _mm_set1_epi16(128));
+		a = _mm_srli_epi16(_mm_add_epi16(a, _mm_srli_epi16(a, 8)), 8);
+		const __m256i a32 = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_unpacklo_epi16(a, a)),
+			_mm_unpackhi_epi16(a, a), 1);
+		const __m256i a_lo = _mm256_unpacklo_epi32(a32, a32);
+		const __m256i a_hi = _mm256_unpackhi_epi32(a32, a32);
+		const __m256i d =
+			_mm256_loadu_si256((const __m256i *)(dst + i));
+		const __m256i lo = _flipclock_canvas_blend_avx2(
+			src, _mm256_unpacklo_epi8(d, zero), a_lo);
+		const __m256i hi = _flipclock_canvas_blend_avx2(
+			src, _mm256_unpackhi_epi8(d, zero), a_hi);
+		_mm256_storeu_si256((__m256i *)(dst + i),
+				    _mm256_packus_epi16(lo, hi));
+	}
+	_flipclock_canvas_blend_row_c(dst + i, mask + i, length - i, color);
+}
+#endif
+
+#if defined(HAVE_NEON)
+static inline uint8x8_t _flipclock_canvas_div255_neon(uint16x8_t x)
+{
+	x = vaddq_u16(x, vdupq_n_u16(128));
+	return vshrn_n_u16(vaddq_u16(x, vshrq_n_u16(x, 8)), 8);
+}
+
+static inline uint8x8_t _flipclock_canvas_blend_neon(uint8_t src,
+						     uint8x8_t dst, uint8x8_t a,
+						     uint8x8_t ia)
+{
+	return _flipclock_canvas_div255_neon(
+		vmlal_u8(vmull_u8(vdup_n_u8(src), a), dst, ia));
+}
+
+// NEON loads 8 pixels as separated channels, so no shuffle is needed.
+static void _flipclock_canvas_blend_row_neon(Uint32 *dst, const Uint8 *mask,
+					     int length, SDL_Color color)
+{
+	const uint8x8_t color_a = vdup_n_u8(color.a);
+	int i = 0;
+	for (; i + 8 <= length; i += 8) {
+		const uint8x8_t m = vld1_u8(mask + i);
+		if (vget_lane_u64(vreinterpret_u64_u8(m), 0) == 0)
+			continue;
+		const uint8x8_t a =
+			_flipclock_canvas_div255_neon(vmull_u8(m, color_a));
+		const uint8x8_t ia = vsub_u8(vdup_n_u8(255), a);
+		uint8x8x4_t d = vld4_u8((const uint8_t *)(dst + i));
+		d.val[0] = _flipclock_canvas_blend_neon(color.b, d.val[0], a,
+							ia);
+		d.val[1] = _flipclock_canvas_blend_neon(color.g, d.val[1], a,
+							ia);
+		d.val[2] = _flipclock_canvas_blend_neon(color.r, d.val[2], a,
+							ia);
+		d.val[3] = _flipclock_canvas_blend_neon(255, d.val[3], a, ia);
+		vst4_u8((uint8_t *)(dst + i), d);
+	}
+	_flipclock_canvas_blend_row_c(dst + i, mask + i, length - i, color);
+}
+#endif
+
+// Set `FLIPCLOCK_CANVAS_KERNEL=c` to compare with the scalar kernel.
+static flipclock_canvas_blend_func
+_flipclock_canvas_select_blend_row(const char **name)
+{
+	const char *forced = SDL_getenv("FLIPCLOCK_CANVAS_KERNEL");
+	const bool scalar = forced != NULL && !strcmp(forced, "c");
+#if defined(HAVE_AVX2)
+	if (!scalar && SDL_HasAVX2()) {
+		*name = "avx2";
+		return _flipclock_canvas_blend_row_avx2;
+	}
+#endif
+#if defined(HAVE_SSE2)
+	if (!scalar && SDL_HasSSE2()) {
+		*name = "sse2";
+		return _flipclock_canvas_blend_row_sse2;
+	}
+#endif
+#if defined(HAVE_NEON)
+	if (!scalar) {
+		*name = "neon";
+		return _flipclock_canvas_blend_row_neon;
+	}
+#endif
+	*name = "c";
+	return _flipclock_canvas_blend_row_c;
+}
+
+/**
+ * Environment is only read for the first canvas, instead of every blending.
+ * Canvases are created by different threads, so lock it.
+ */
+static flipclock_canvas_blend_func
+_flipclock_canvas_get_blend_row(const char **name)
+{
+	static SDL_SpinLock lock = 0;
+	static flipclock_canvas_blend_func blend_row = NULL;
+	static const char *blend_row_name = NULL;
+
+	SDL_AtomicLock(&lock);
+	if (blend_row == NULL)
+		blend_row = _flipclock_canvas_select_blend_row(&blend_row_name);
+	const flipclock_canvas_blend_func selected = blend_row;
+	*name = blend_row_name;
+	SDL_AtomicUnlock(&lock);
+	return selected;
+}
+
+/**
+ * Blend two colors like kernels, so callers can fill rects that are known to
+ * be covered by one color, instead of blending every pixel.
+ */
+SDL_Color flipclock_canvas_blend_color(SDL_Color src, SDL_Color dst)
+{
+	const Uint32 ia = 255 - src.a;
+	SDL_Color color;
+	color.r = _flipclock_canvas_div255(src.r * src.a + dst.r * ia);
+	color.g = _flipclock_canvas_div255(src.g * src.a + dst.g * ia);
+	color.b = _flipclock_canvas_div255(src.b * src.a + dst.b * ia);
+	color.a = _flipclock_canvas_div255(255 * src.a + dst.a * ia);
+	return color;
+}
+
+const char *flipclock_canvas_get_kernel_name(void)
+{
+	const char *name = NULL;
+	_flipclock_canvas_get_blend_row(&name);
+	return name;
+}
+
+/**
+ * Pitch is in bytes like SDL, clip is the whole canvas. Callers that move
+ * origin must also keep clip inside the pixels.
+ */
+void flipclock_canvas_init(struct flipclock_canvas *canvas, void *pixels,
+			   int w, int h, int pitch)
+{
+	RETURN_IF_FAIL(canvas != NULL);
+	RETURN_IF_FAIL(pixels != NULL);
+
+	canvas->pixels = pixels;
+	canvas->x = 0;
+	canvas->y = 0;
+	canvas->w = w;
+	canvas->h = h;
+	canvas->pitch = pitch / sizeof(*canvas->pixels);
+	canvas->clip.x = 0;
+	canvas->clip.y = 0;
+	canvas->clip.w = w;
+	canvas->clip.h = h;
+	const char *name = NULL;
+	canvas->blend_row = _flipclock_canvas_get_blend_row(&name);
+}
+
+/**
+ * Clip rect into clip of canvas, and return how many pixels are cut from left
+ * and top, so callers can move mask with it. Returns false if nothing is left.
+ */
+static bool _flipclock_canvas_clip(const struct flipclock_canvas *canvas,
+				   SDL_Rect *rect, int *skip_x, int *skip_y)
+{
+	const SDL_Rect *clip = &canvas->clip;
+	*skip_x = rect->x < clip->x ? clip->x - rect->x : 0;
+	*skip_y = rect->y < clip->y ? clip->y - rect->y : 0;
+	rect->x += *skip_x;
+	rect->y += *skip_y;
+	rect->w -= *skip_x;
+	rect->h -= *skip_y;
+	if (rect->x + rect->w > clip->x + clip->w)
+		rect->w = clip->x + clip->w - rect->x;
+	if (rect->y + rect->h > clip->y + clip->h)
+		rect->h = clip->y + clip->h - rect->y;
+	return rect->w > 0 && rect->h > 0;
+}
+
+// Pixel at the given position, it must be inside clip.
+static Uint32 *
+_flipclock_canvas_get_pixel(const struct flipclock_canvas *canvas, int x,
+			    int y)
+{
+	return canvas->pixels + (y - canvas->y) * canvas->pitch + x - canvas->x;
+}
+
+static Uint32 _flipclock_canvas_map_color(SDL_Color color)
+{
+	return ((Uint32)color.a << 24) | ((Uint32)color.r << 16) |
+	       ((Uint32)color.g << 8) | (Uint32)color.b;
+}
+
+// Replace pixels like `SDL_RenderFillRect()` with `SDL_BLENDMODE_NONE`.
+void flipclock_canvas_fill_rect(struct flipclock_canvas *canvas,
+				SDL_Rect rect, SDL_Color color)
+{
+	RETURN_IF_FAIL(canvas != NULL);
+
+	int skip_x;
+	int skip_y;
+	if (!_flipclock_canvas_clip(canvas, &rect, &skip_x, &skip_y))
+		return;
+	const Uint32 pixel = _flipclock_canvas_map_color(color);
+	for (int y = rect.y; y < rect.y + rect.h; ++y)
+		SDL_memset4(_flipclock_canvas_get_pixel(canvas, rect.x, y),
+			    pixel, rect.w);
+}
+
+/**
+ * Replace pixels with color and mask as alpha, like copying a texture with
+ * `SDL_BLENDMODE_NONE`. Mask points to the pixel for the top left of rect.
+ */
+void flipclock_canvas_store_mask(struct flipclock_canvas *canvas,
+				 SDL_Rect rect, const Uint8 mask[],
+				 int mask_pitch, SDL_Color color)
+{
+	RETURN_IF_FAIL(canvas != NULL);
+	RETURN_IF_FAIL(mask != NULL);
+
+	int skip_x;
+	int skip_y;
+	if (!_flipclock_canvas_clip(canvas, &rect, &skip_x, &skip_y))
+		return;
+	const Uint32 pixel = _flipclock_canvas_map_color(color) & 0x00ffffff;
+	for (int y = 0; y < rect.h; ++y) {
+		Uint32 *row =
+			_flipclock_canvas_get_pixel(canvas, rect.x, rect.y + y);
+		const Uint8 *mask_row =
+			mask + (skip_y + y) * mask_pitch + skip_x;
+		for (int x = 0; x < rect.w; ++x)
+			row[x] = ((Uint32)mask_row[x] << 24) | pixel;
+	}
+}
+
+// Blend color with mask as coverage, like copying a glyph texture.
+void flipclock_canvas_blend_mask(struct flipclock_canvas *canvas,
+				 SDL_Rect rect, const Uint8 mask[],
+				 int mask_pitch, SDL_Color color)
+{
+	RETURN_IF_FAIL(canvas != NULL);
+	RETURN_IF_FAIL(mask != NULL);
+
+	int skip_x;
+	int skip_y;
+	if (!_flipclock_canvas_clip(canvas, &rect, &skip_x, &skip_y))
+		return;
+	for (int y = 0; y < rect.h; ++y)
+		canvas->blend_row(
+			_flipclock_canvas_get_pixel(canvas, rect.x, rect.y + y),
+			mask + (skip_y + y) * mask_pitch + skip_x, rect.w,
+			color);
+}
@@ -0,0 +1,49 @@
+#ifndef __CANVAS_H__
+#define __CANVAS_H__
+
+#include <SDL.h>
+
+typedef void (*flipclock_canvas_blend_func)(Uint32 *dst, const Uint8 *mask,
+					    int length, SDL_Color color);
+
+/**
+ * An ARGB8888 pixel buffer, faces are composed on it by CPU when rendering
+ * with a software renderer, because render targets and blended copies of SDL
+ * software renderer are generic and slow. It does not own pixels, normally
+ * they are from a locked streaming texture.
+ */
+struct flipclock_canvas {
+	Uint32 *pixels;
+	/**
+	 * Position of the first pixel, so a tile of a larger image can use
+	 * coordinates of the whole image.
+	 */
+	int x;
+	int y;
+	int w;
+	int h;
+	// In pixels, not bytes.
+	int pitch;
+	/**
+	 * Only pixels inside it are written, so different parts of a canvas
+	 * can be composed by different threads.
+	 */
+	SDL_Rect clip;
+	// Kernel blending a row of mask, it is only selected once.
+	flipclock_canvas_blend_func blend_row;
+};
+
+void flipclock_canvas_init(struct flipclock_canvas *canvas, void *pixels,
+			   int w, int h, int pitch);
+void flipclock_canvas_fill_rect(struct flipclock_canvas *canvas,
+				SDL_Rect rect, SDL_Color color);
+void flipclock_canvas_store_mask(struct flipclock_canvas *canvas,
+				 SDL_Rect rect, const Uint8 mask[],
+				 int mask_pitch, SDL_Color color);
+void flipclock_canvas_blend_mask(struct flipclock_canvas *canvas,
+				 SDL_Rect rect, const Uint8 mask[],
+				 int mask_pitch, SDL_Color color);
+SDL_Color flipclock_canvas_blend_color(SDL_Color src, SDL_Color dst);
+const char *flipclock_canvas_get_kernel_name(void);
+
+#endif
@@ -6,16 +6,34 @@
 
 #include "flipclock.h"
 #include "card.h"
+#include "atlas.h"
+#include "canvas.h"
+#include "tiles.h"
+#include "trace.h"
+#include "worker.h"
 
 #define PI 3.1415927
-#define MAX_PROGRESS 300
-#define HALF_PROGRESS (MAX_PROGRESS / 2)
+#define MIN_FACES 3
+#define FACES_MEMORY_BUDGET (32 * 1024 * 1024)
+// Smaller bands are not worth waking up workers.
+#define MIN_BAND_HEIGHT 64
+#define MAX_BANDS (MAX_WORKERS + 1)
+
+// A part of a face composed by a worker.
+struct flipclock_card_band {
+	struct flipclock_card *card;
+	struct flipclock_canvas canvas;
+	const char *text;
+	struct flipclock_job job;
+};
 
 struct flipclock_card *flipclock_card_create(struct flipclock *app,
-					     SDL_Renderer *renderer)
+					     SDL_Renderer *renderer,
+					     struct flipclock_atlases *atlases)
 {
 	RETURN_VAL_IF_FAIL(app != NULL, NULL);
 	RETURN_VAL_IF_FAIL(renderer != NULL, NULL);
+	RETURN_VAL_IF_FAIL(atlases != NULL, NULL);
 
 	struct flipclock_card *card = malloc(sizeof(*card));
 	if (card == NULL) {
@@ -26,262 +44,630 @@ struct flipclock_card *flipclock_card_create(struct flipclock *app,
 	card->renderer = renderer;
 	card->current = NULL;
 	card->previous = NULL;
+	card->next = NULL;
 	card->should_redraw = false;
+	card->stale_faces = false;
+	card->flipping = false;
 	card->start_tick = 0;
+	card->flip_duration = MAX_PROGRESS;
 	card->text[0] = '\0';
-	card->font = NULL;
+	card->next_text[0] = '\0';
+	card->should_prepare = false;
 	card->has_sub_text = false;
 	card->sub_text[0] = '\0';
-	card->sub_font = NULL;
+	card->atlases = atlases;
+	card->atlas = NULL;
+	card->sub_atlas = NULL;
+	card->faces_length = 0;
+	card->faces_capacity = MIN_FACES;
+	card->faces_tick = 0;
 	card->divider_height = 0;
+	card->radius = 0;
+	card->corners = NULL;
+	card->corner_mask = NULL;
+	/**
+	 * Render targets of software renderer are slow, compose faces by CPU
+	 * instead.
+	 */
+	SDL_RendererInfo info;
+	card->cpu_compose = app->cpu_compose ||
+			    (SDL_GetRendererInfo(renderer, &info) == 0 &&
+			     (info.flags & SDL_RENDERER_SOFTWARE));
 	card->rect.w = 0;
 	card->rect.h = 0;
+	card->target_rect = card->rect;
 	return card;
 }
 
-static void _flipclock_card_create_textures(struct flipclock_card *card)
+static void _flipclock_card_destroy_faces(struct flipclock_card *card)
 {
 	RETURN_IF_FAIL(card != NULL);
 
-	LOG_DEBUG("Creating new textures with size `%dx%d`.\n", card->rect.w,
-		  card->rect.h);
-	card->current = SDL_CreateTexture(card->renderer, 0,
-					  SDL_TEXTUREACCESS_TARGET,
-					  card->rect.w, card->rect.h);
-	if (card->current == NULL) {
-		LOG_ERROR("%s\n", SDL_GetError());
-		exit(EXIT_FAILURE);
-	}
-	SDL_SetTextureBlendMode(card->current, SDL_BLENDMODE_BLEND);
-	card->previous = SDL_CreateTexture(card->renderer, 0,
-					   SDL_TEXTUREACCESS_TARGET,
-					   card->rect.w, card->rect.h);
-	if (card->previous == NULL) {
-		LOG_ERROR("%s\n", SDL_GetError());
-		exit(EXIT_FAILURE);
-	}
-	SDL_SetTextureBlendMode(card->previous, SDL_BLENDMODE_BLEND);
+	LOG_DEBUG("Destroying old faces.\n");
+	for (int i = 0; i < card->faces_length; ++i)
+		flipclock_tiles_destroy(card->faces[i].tiles);
+	card->faces_length = 0;
+	card->stale_faces = false;
+	// They are pointers to faces so they are not valid now.
+	card->current = NULL;
+	card->previous = NULL;
+	card->next = NULL;
 }
 
-static void _flipclock_card_destroy_textures(struct flipclock_card *card)
+static void _flipclock_card_open_font(struct flipclock_card *card)
 {
 	RETURN_IF_FAIL(card != NULL);
 
-	LOG_DEBUG("Destroying old textures.\n");
-	if (card->current != NULL) {
-		SDL_DestroyTexture(card->current);
-		card->current = NULL;
-	}
-	if (card->previous != NULL) {
-		SDL_DestroyTexture(card->previous);
-		card->previous = NULL;
-	}
+	const Uint64 trace_start = flipclock_trace_begin();
+	const int size = card->rect.h * card->app->text_scale;
+	// Glyphs are only rasterized by workers when no card has this size.
+	card->atlas =
+		flipclock_atlases_open(card->atlases, size, card->cpu_compose);
+	flipclock_trace_end(__func__, trace_start);
 }
 
-// TODO: Only open sub font if sub text used.
-static void _flipclock_card_open_fonts(struct flipclock_card *card)
+static void _flipclock_card_close_font(struct flipclock_card *card)
 {
 	RETURN_IF_FAIL(card != NULL);
 
-	const struct flipclock *app = card->app;
-	LOG_DEBUG("Opening font from `%s`.\n", app->font_path);
-	card->font =
-		TTF_OpenFont(app->font_path, card->rect.h * app->text_scale);
-	card->sub_font = TTF_OpenFont(app->font_path,
-				      card->sub_rect.h * app->text_scale);
-	if (card->font == NULL || card->sub_font == NULL) {
-		LOG_ERROR("%s\n", TTF_GetError());
-		exit(EXIT_FAILURE);
+	if (card->atlas != NULL) {
+		flipclock_atlases_close(card->atlases, card->atlas);
+		card->atlas = NULL;
 	}
 }
 
-static void _flipclock_card_close_fonts(struct flipclock_card *card)
+// Sub font is only opened when sub text is used.
+static void _flipclock_card_open_sub_font(struct flipclock_card *card)
 {
 	RETURN_IF_FAIL(card != NULL);
 
-	LOG_DEBUG("Closing old font.\n");
-	if (card->font != NULL) {
-		TTF_CloseFont(card->font);
-		card->font = NULL;
-	}
-	if (card->sub_font != NULL) {
-		TTF_CloseFont(card->sub_font);
-		card->sub_font = NULL;
+	const Uint64 trace_start = flipclock_trace_begin();
+	const int size = card->sub_rect.h * card->app->text_scale;
+	card->sub_atlas =
+		flipclock_atlases_open(card->atlases, size, card->cpu_compose);
+	flipclock_trace_end(__func__, trace_start);
+}
+
+static void _flipclock_card_close_sub_font(struct flipclock_card *card)
+{
+	RETURN_IF_FAIL(card != NULL);
+
+	if (card->sub_atlas != NULL) {
+		flipclock_atlases_close(card->atlases, card->sub_atlas);
+		card->sub_atlas = NULL;
 	}
 }
 
-static void _flipclock_card_clear_current_texture(struct flipclock_card *card)
+static void _flipclock_card_destroy_corners(struct flipclock_card *card)
 {
 	RETURN_IF_FAIL(card != NULL);
 
-	SDL_SetRenderTarget(card->renderer, card->current);
-	// Always clear texture with transparent so rounded corner will be fine.
-	SDL_SetRenderDrawColor(card->renderer, 0x00, 0x00, 0x00, 0x00);
-	SDL_RenderClear(card->renderer);
-	SDL_SetRenderTarget(card->renderer, NULL);
+	if (card->corners != NULL) {
+		SDL_DestroyTexture(card->corners);
+		card->corners = NULL;
+	}
+	free(card->corner_mask);
+	card->corner_mask = NULL;
 }
 
-static void _flipclock_card_draw_rounded_box(struct flipclock_card *card)
+/**
+ * Corners only depend on radius and box color, so draw them once for a card
+ * size instead of drawing lines for every face. Alpha is the part of a pixel
+ * covered by the circle, so corners are anti-aliased.
+ */
+static void _flipclock_card_create_corners(struct flipclock_card *card)
 {
 	RETURN_IF_FAIL(card != NULL);
 
 	const struct flipclock *app = card->app;
-	// Card-local position.
-	const SDL_Rect box_rect = { 0, 0, card->rect.w, card->rect.h };
-	if (2 * card->radius > box_rect.w)
-		card->radius = box_rect.w / 2;
-	if (2 * card->radius > box_rect.h)
-		card->radius = box_rect.h / 2;
+	_flipclock_card_destroy_corners(card);
 	// Worst case: a normal rect.
-	if (card->radius <= 1) {
-		SDL_SetRenderTarget(card->renderer, card->current);
-		SDL_SetRenderDrawColor(card->renderer, app->box_color.r,
-				       app->box_color.g, app->box_color.b,
-				       app->box_color.a);
-		SDL_RenderFillRect(card->renderer, &box_rect);
-		SDL_SetRenderTarget(card->renderer, NULL);
+	if (card->radius <= 1)
 		return;
-	}
 
-	SDL_SetRenderTarget(card->renderer, card->current);
-	SDL_SetRenderDrawColor(card->renderer, app->box_color.r,
-			       app->box_color.g, app->box_color.b,
-			       app->box_color.a);
-	int x = 0;
-	int y = card->radius;
-	int d = 3 - 2 * card->radius;
-	while (x <= y) {
-		SDL_RenderDrawLine(
-			card->renderer, box_rect.x + card->radius - x,
-			box_rect.y + card->radius - y,
-			box_rect.x + box_rect.w - card->radius + x - 1,
-			box_rect.y + card->radius - y);
-		SDL_RenderDrawLine(
-			card->renderer, box_rect.x + card->radius - x,
-			box_rect.y + box_rect.h - card->radius + y,
-			box_rect.x + box_rect.w - card->radius + x - 1,
-			box_rect.y + box_rect.h - card->radius + y);
-		SDL_RenderDrawLine(
-			card->renderer, box_rect.x + card->radius - y,
-			box_rect.y + card->radius - x,
-			box_rect.x + box_rect.w - card->radius + y - 1,
-			box_rect.y + card->radius - x);
-		SDL_RenderDrawLine(
-			card->renderer, box_rect.x + card->radius - y,
-			box_rect.y + box_rect.h - card->radius + x,
-			box_rect.x + box_rect.w - card->radius + y - 1,
-			box_rect.y + box_rect.h - card->radius + x);
-		if (d < 0) {
-			d = d + 4 * x + 6;
-		} else {
-			d = d + 4 * (x - y) + 10;
-			--y;
+	const Uint64 trace_start = flipclock_trace_begin();
+	const int size = 2 * card->radius;
+	card->corner_mask = malloc(size * size);
+	if (card->corner_mask == NULL) {
+		LOG_ERROR("Failed to create corners!\n");
+		exit(EXIT_FAILURE);
+	}
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			// Distance from pixel center to circle center.
+			double dx = x + 0.5 - card->radius;
+			double dy = y + 0.5 - card->radius;
+			double coverage =
+				card->radius - sqrt(dx * dx + dy * dy) + 0.5;
+			if (coverage < 0)
+				coverage = 0;
+			if (coverage > 1)
+				coverage = 1;
+			card->corner_mask[y * size + x] =
+				coverage * app->box_color.a + 0.5;
 		}
-		++x;
-	}
-	SDL_Rect temp_rect;
-	temp_rect.x = box_rect.x;
-	temp_rect.y = box_rect.y + card->radius;
-	temp_rect.w = box_rect.w;
-	temp_rect.h = box_rect.h - 2 * card->radius;
-	SDL_RenderFillRect(card->renderer, &temp_rect);
-	SDL_SetRenderTarget(card->renderer, NULL);
+	}
+	// CPU composing only needs the mask.
+	if (card->cpu_compose) {
+		flipclock_trace_end(__func__, trace_start);
+		return;
+	}
+
+	SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+		0, size, size, 32, SDL_PIXELFORMAT_ARGB8888);
+	if (surface == NULL) {
+		LOG_ERROR("%s\n", SDL_GetError());
+		exit(EXIT_FAILURE);
+	}
+	SDL_LockSurface(surface);
+	const Uint32 color = ((Uint32)app->box_color.r << 16) |
+			     ((Uint32)app->box_color.g << 8) |
+			     (Uint32)app->box_color.b;
+	for (int y = 0; y < size; ++y) {
+		Uint32 *row = (Uint32 *)((Uint8 *)surface->pixels +
+					 y * surface->pitch);
+		for (int x = 0; x < size; ++x)
+			row[x] = ((Uint32)card->corner_mask[y * size + x]
+				  << 24) |
+				 color;
+	}
+	SDL_UnlockSurface(surface);
+	card->corners = SDL_CreateTextureFromSurface(card->renderer, surface);
+	SDL_FreeSurface(surface);
+	if (card->corners == NULL) {
+		LOG_ERROR("%s\n", SDL_GetError());
+		exit(EXIT_FAILURE);
+	}
+	/**
+	 * Corners are drawn first on a transparent face, copy alpha as is so
+	 * edges won't be darkened by blending with nothing.
+	 */
+	SDL_SetTextureBlendMode(card->corners, SDL_BLENDMODE_NONE);
+	flipclock_trace_end(__func__, trace_start);
 }
 
-// A special text drawing function, will draw all chars as mono.
-static void _draw_text(SDL_Renderer *renderer, SDL_Texture *target_texture,
-		       SDL_Rect target_rect, TTF_Font *font, SDL_Color color,
-		       const char text[])
+/**
+ * Parts are drawn on a tile of the face, so card-local positions are moved by
+ * the position of the tile.
+ */
+static void _flipclock_card_draw_rounded_box(struct flipclock_card *card,
+					     SDL_Rect tile_rect)
 {
-	RETURN_IF_FAIL(renderer != NULL);
-	RETURN_IF_FAIL(target_texture != NULL);
-	RETURN_IF_FAIL(font != NULL);
-	RETURN_IF_FAIL(text != NULL);
+	RETURN_IF_FAIL(card != NULL);
 
-	int len = strlen(text);
-	LOG_DEBUG("Drawing text `%s`.\n", text);
-	SDL_SetRenderTarget(renderer, target_texture);
-	for (int i = 0; i < len; ++i) {
-		/**
-		 * See <https://www.libsdl.org/projects/SDL_ttf/docs/SDL_ttf_42.html#SEC42>.
-		 * Normally shaded is enough, however we have a rounded box,
-		 * and many fonts' boxes are too big compared with their
-		 * characters, they just cover the rounded corner.
-		 * So I have to use blended mode, because solid mode does not
-		 * have anti-alias.
-		 */
-		SDL_Surface *text_surface =
-			TTF_RenderGlyph_Blended(font, text[i], color);
-		if (text_surface == NULL) {
-			LOG_ERROR("%s\n", TTF_GetError());
-			exit(EXIT_FAILURE);
-		}
-		SDL_Texture *text_texture =
-			SDL_CreateTextureFromSurface(renderer, text_surface);
-		if (text_texture == NULL) {
-			LOG_ERROR("%s\n", TTF_GetError());
-			exit(EXIT_FAILURE);
-		}
-		SDL_Rect text_rect;
-		text_rect.x = target_rect.x + target_rect.w / len * i +
-			      (target_rect.w / len - text_surface->w) / 2;
-		text_rect.y =
-			target_rect.y + (target_rect.h - text_surface->h) / 2;
-		text_rect.w = text_surface->w;
-		text_rect.h = text_surface->h;
-		SDL_FreeSurface(text_surface);
-		SDL_RenderCopy(renderer, text_texture, NULL, &text_rect);
-		SDL_DestroyTexture(text_texture);
+	const Uint64 trace_start = flipclock_trace_begin();
+	const struct flipclock *app = card->app;
+	// Tile-local position.
+	const SDL_Rect box_rect = { -tile_rect.x, -tile_rect.y, card->rect.w,
+				    card->rect.h };
+	SDL_SetRenderDrawColor(card->renderer, app->box_color.r,
+			       app->box_color.g, app->box_color.b,
+			       app->box_color.a);
+	if (card->corners == NULL) {
+		SDL_RenderFillRect(card->renderer, &box_rect);
+		flipclock_trace_end(__func__, trace_start);
+		return;
 	}
-	SDL_SetRenderTarget(renderer, NULL);
+
+	const int r = card->radius;
+	// Top left, top right, bottom left and bottom right.
+	const SDL_Rect corner_rects[4] = {
+		{ 0, 0, r, r },
+		{ r, 0, r, r },
+		{ 0, r, r, r },
+		{ r, r, r, r },
+	};
+	const SDL_Rect target_rects[4] = {
+		{ box_rect.x, box_rect.y, r, r },
+		{ box_rect.x + box_rect.w - r, box_rect.y, r, r },
+		{ box_rect.x, box_rect.y + box_rect.h - r, r, r },
+		{ box_rect.x + box_rect.w - r, box_rect.y + box_rect.h - r, r,
+		  r },
+	};
+	for (int i = 0; i < 4; ++i)
+		SDL_RenderCopy(card->renderer, card->corners, &corner_rects[i],
+			       &target_rects[i]);
+	// Top and bottom parts between corners, and the middle part.
+	const SDL_Rect fill_rects[3] = {
+		{ box_rect.x + r, box_rect.y, box_rect.w - 2 * r, r },
+		{ box_rect.x + r, box_rect.y + box_rect.h - r,
+		  box_rect.w - 2 * r, r },
+		{ box_rect.x, box_rect.y + r, box_rect.w, box_rect.h - 2 * r },
+	};
+	SDL_RenderFillRects(card->renderer, fill_rects, 3);
+	flipclock_trace_end(__func__, trace_start);
 }
 
-static void _flipclock_card_draw_text(struct flipclock_card *card)
+static void _flipclock_card_draw_text(struct flipclock_card *card,
+				      SDL_Rect tile_rect, const char text[])
 {
 	RETURN_IF_FAIL(card != NULL);
+	RETURN_IF_FAIL(text != NULL);
 
-	const struct flipclock *app = card->app;
-	// Card-local position.
-	const SDL_Rect box_rect = { 0, 0, card->rect.w, card->rect.h };
-	_draw_text(card->renderer, card->current, box_rect, card->font,
-		   app->text_color, card->text);
+	const Uint64 trace_start = flipclock_trace_begin();
+	// Tile-local position.
+	const SDL_Rect box_rect = { -tile_rect.x, -tile_rect.y, card->rect.w,
+				    card->rect.h };
+	flipclock_atlas_draw_text(card->atlas, box_rect, text);
 	if (card->has_sub_text) {
-		_draw_text(card->renderer, card->current, card->sub_rect,
-			   card->sub_font, app->text_color, card->sub_text);
+		SDL_Rect sub_rect = card->sub_rect;
+		sub_rect.x -= tile_rect.x;
+		sub_rect.y -= tile_rect.y;
+		flipclock_atlas_draw_text(card->sub_atlas, sub_rect,
+					  card->sub_text);
 	}
+	flipclock_trace_end(__func__, trace_start);
 }
 
-static void _flipclock_card_draw_divider(struct flipclock_card *card)
+static void _flipclock_card_draw_divider(struct flipclock_card *card,
+					 SDL_Rect tile_rect)
 {
 	RETURN_IF_FAIL(card != NULL);
 
+	const Uint64 trace_start = flipclock_trace_begin();
 	const struct flipclock *app = card->app;
-	SDL_Rect divider_rect = { 0, (card->rect.h - card->divider_height) / 2,
-				  card->rect.w, card->divider_height };
-	SDL_SetRenderTarget(card->renderer, card->current);
+	SDL_Rect divider_rect = {
+		-tile_rect.x,
+		(card->rect.h - card->divider_height) / 2 - tile_rect.y,
+		card->rect.w, card->divider_height
+	};
 	// Don't be transparent, or you will not see divider, it's over card.
 	SDL_SetRenderDrawColor(card->renderer, app->background_color.r,
 			       app->background_color.g, app->background_color.b,
 			       app->background_color.a);
 	SDL_RenderFillRect(card->renderer, &divider_rect);
-	SDL_SetRenderTarget(card->renderer, NULL);
+	flipclock_trace_end(__func__, trace_start);
 }
 
-static void _flipclock_card_draw(struct flipclock_card *card)
+/**
+ * Compose the same face as drawing with renderer on CPU, parts are only
+ * written inside clip of canvas. Box is filled by parts that don't overlap,
+ * so we don't need to clear it first.
+ */
+static void _flipclock_card_compose_band(struct flipclock_card *card,
+					 struct flipclock_canvas *canvas,
+					 const char text[])
 {
 	RETURN_IF_FAIL(card != NULL);
+	RETURN_IF_FAIL(canvas != NULL);
+	RETURN_IF_FAIL(text != NULL);
 
-	// Always do texture swap before drawing.
-	SDL_Texture *swap = card->current;
-	card->current = card->previous;
-	card->previous = swap;
+	const struct flipclock *app = card->app;
+	const int w = card->rect.w;
+	const int h = card->rect.h;
+	// Renderer blends box with the transparent face.
+	const SDL_Color transparent = { 0x00, 0x00, 0x00, 0x00 };
+	const SDL_Color box_color =
+		flipclock_canvas_blend_color(app->box_color, transparent);
+	if (card->corner_mask == NULL) {
+		const SDL_Rect box_rect = { 0, 0, w, h };
+		flipclock_canvas_fill_rect(canvas, box_rect, box_color);
+	} else {
+		const int r = card->radius;
+		const int size = 2 * r;
+		// Top left, top right, bottom left and bottom right.
+		const SDL_Rect target_rects[4] = {
+			{ 0, 0, r, r },
+			{ w - r, 0, r, r },
+			{ 0, h - r, r, r },
+			{ w - r, h - r, r, r },
+		};
+		const int mask_offsets[4] = { 0, r, r * size, r * size + r };
+		for (int i = 0; i < 4; ++i)
+			flipclock_canvas_store_mask(
+				canvas, target_rects[i],
+				card->corner_mask + mask_offsets[i], size,
+				app->box_color);
+		const SDL_Rect fill_rects[3] = {
+			{ r, 0, w - 2 * r, r },
+			{ r, h - r, w - 2 * r, r },
+			{ 0, r, w, h - 2 * r },
+		};
+		for (int i = 0; i < 3; ++i)
+			flipclock_canvas_fill_rect(canvas, fill_rects[i],
+						   box_color);
+	}
+	const SDL_Rect box_rect = { 0, 0, w, h };
+	flipclock_atlas_compose_text(card->atlas, canvas, box_rect, text);
+	if (card->has_sub_text)
+		flipclock_atlas_compose_text(card->sub_atlas, canvas,
+					     card->sub_rect, card->sub_text);
+	// Divider is always over the middle part of box.
+	const SDL_Rect divider_rect = { 0, (h - card->divider_height) / 2, w,
+					card->divider_height };
+	flipclock_canvas_fill_rect(
+		canvas, divider_rect,
+		flipclock_canvas_blend_color(app->background_color,
+					     box_color));
+}
 
-	_flipclock_card_clear_current_texture(card);
+static void _flipclock_card_compose_band_job(void *data)
+{
+	struct flipclock_card_band *band = data;
+
+	_flipclock_card_compose_band(band->card, &band->canvas, band->text);
+}
+
+/**
+ * Split a rect inside a tile of the face into horizontal bands and compose
+ * them with workers, this thread composes the last band instead of only
+ * waiting. Every pixel is written by the same steps in any band, so the result
+ * does not depend on how many workers we have, and only composing a part of
+ * the face gives the same pixels as composing all of it.
+ */
+static void _flipclock_card_compose_tile(struct flipclock_card *card,
+					 struct flipclock_tiles *target, int i,
+					 SDL_Rect rect, const char text[])
+{
+	RETURN_IF_FAIL(card != NULL);
+	RETURN_IF_FAIL(target != NULL);
+	RETURN_IF_FAIL(text != NULL);
+
+	struct flipclock_workers *workers = card->app->workers;
+	const SDL_Rect tile_rect = flipclock_tiles_get_rect(target, i);
+	// Tile-local position.
+	const SDL_Rect lock_rect = { rect.x - tile_rect.x, rect.y - tile_rect.y,
+				     rect.w, rect.h };
+	void *pixels;
+	int pitch;
+	if (SDL_LockTexture(target->textures[i], &lock_rect, &pixels, &pitch) <
+	    0) {
+		LOG_ERROR("%s\n", SDL_GetError());
+		exit(EXIT_FAILURE);
+	}
+	// Canvas uses card-local positions, only the rect is inside clip.
+	struct flipclock_canvas canvas;
+	flipclock_canvas_init(&canvas, pixels, rect.w, rect.h, pitch);
+	canvas.x = rect.x;
+	canvas.y = rect.y;
+	canvas.clip = rect;
+	int bands_length = workers != NULL ? workers->threads_length + 1 : 1;
+	if (bands_length > rect.h / MIN_BAND_HEIGHT)
+		bands_length = rect.h / MIN_BAND_HEIGHT;
+	if (bands_length < 1)
+		bands_length = 1;
+	struct flipclock_card_band bands[MAX_BANDS];
+	const int band_height = (rect.h + bands_length - 1) / bands_length;
+	for (int j = 0; j < bands_length; ++j) {
+		struct flipclock_card_band *band = &bands[j];
+		band->card = card;
+		band->text = text;
+		band->canvas = canvas;
+		band->canvas.clip.y = rect.y + j * band_height;
+		band->canvas.clip.h = band_height;
+		if (band->canvas.clip.y + band->canvas.clip.h > rect.y + rect.h)
+			band->canvas.clip.h = rect.y + rect.h -
+					      band->canvas.clip.y;
+		flipclock_job_init(&band->job, _flipclock_card_compose_band_job,
+				   band);
+		if (j < bands_length - 1)
+			flipclock_workers_push(workers, &band->job);
+	}
+	_flipclock_card_compose_band(card, &bands[bands_length - 1].canvas,
+				     text);
+	for (int j = 0; j < bands_length - 1; ++j)
+		flipclock_workers_wait(workers, &bands[j].job);
+	SDL_UnlockTexture(target->textures[i]);
+}
 
+static void _flipclock_card_compose_face(struct flipclock_card *card,
+					 struct flipclock_tiles *target,
+					 const char text[])
+{
+	RETURN_IF_FAIL(card != NULL);
+	RETURN_IF_FAIL(target != NULL);
+	RETURN_IF_FAIL(text != NULL);
+
+	const Uint64 trace_start = flipclock_trace_begin();
+	// Workers only read glyphs, so they must be ready before.
+	flipclock_atlas_wait(card->atlas);
+	if (card->has_sub_text)
+		flipclock_atlas_wait(card->sub_atlas);
+	for (int i = 0; i < flipclock_tiles_get_length(target); ++i)
+		_flipclock_card_compose_tile(
+			card, target, i, flipclock_tiles_get_rect(target, i),
+			text);
+	flipclock_trace_end(__func__, trace_start);
+}
+
+/**
+ * Only compose the part of a composed face that old text and new text cover,
+ * box and divider around them are not changed.
+ */
+static void _flipclock_card_compose_text(struct flipclock_card *card,
+					 struct flipclock_tiles *target,
+					 const char old_text[],
+					 const char text[])
+{
+	RETURN_IF_FAIL(card != NULL);
+	RETURN_IF_FAIL(target != NULL);
+	RETURN_IF_FAIL(old_text != NULL);
+	RETURN_IF_FAIL(text != NULL);
+
+	const Uint64 trace_start = flipclock_trace_begin();
+	flipclock_atlas_wait(card->atlas);
+	if (card->has_sub_text)
+		flipclock_atlas_wait(card->sub_atlas);
+	const SDL_Rect box_rect = { 0, 0, card->rect.w, card->rect.h };
+	const SDL_Rect old_rect =
+		flipclock_atlas_get_text_rect(card->atlas, box_rect, old_text);
+	SDL_Rect rect =
+		flipclock_atlas_get_text_rect(card->atlas, box_rect, text);
+	SDL_UnionRect(&rect, &old_rect, &rect);
+	for (int i = 0; i < flipclock_tiles_get_length(target); ++i) {
+		const SDL_Rect tile_rect = flipclock_tiles_get_rect(target, i);
+		SDL_Rect tile_text_rect;
+		if (SDL_IntersectRect(&rect, &tile_rect, &tile_text_rect))
+			_flipclock_card_compose_tile(card, target, i,
+						     tile_text_rect, text);
+	}
+	flipclock_trace_end(__func__, trace_start);
+}
+
+static void _flipclock_card_draw_face(struct flipclock_card *card,
+				      struct flipclock_tiles *target,
+				      const char text[])
+{
+	RETURN_IF_FAIL(card != NULL);
+	RETURN_IF_FAIL(target != NULL);
+	RETURN_IF_FAIL(text != NULL);
+
+	if (card->cpu_compose) {
+		_flipclock_card_compose_face(card, target, text);
+		return;
+	}
+
+	const Uint64 trace_start = flipclock_trace_begin();
 	LOG_DEBUG("Drawing card.\n");
-	_flipclock_card_draw_rounded_box(card);
-	_flipclock_card_draw_text(card);
-	_flipclock_card_draw_divider(card);
+	// Set target once for each tile and draw all parts of the face on it.
+	for (int i = 0; i < flipclock_tiles_get_length(target); ++i) {
+		const SDL_Rect tile_rect = flipclock_tiles_get_rect(target, i);
+		SDL_SetRenderTarget(card->renderer, target->textures[i]);
+		/**
+		 * Always clear texture with transparent so rounded corner will
+		 * be fine.
+		 */
+		SDL_SetRenderDrawColor(card->renderer, 0x00, 0x00, 0x00, 0x00);
+		SDL_RenderClear(card->renderer);
+		_flipclock_card_draw_rounded_box(card, tile_rect);
+		_flipclock_card_draw_text(card, tile_rect, text);
+		_flipclock_card_draw_divider(card, tile_rect);
+	}
+	SDL_SetRenderTarget(card->renderer, NULL);
+	flipclock_trace_end("flipclock_card_draw", trace_start);
+}
+
+// Draw a face for current texts on target, it does not change displayed faces.
+void flipclock_card_draw(struct flipclock_card *card,
+			 struct flipclock_tiles *target)
+{
+	RETURN_IF_FAIL(card != NULL);
+	RETURN_IF_FAIL(target != NULL);
+
+	_flipclock_card_draw_face(card, target, card->text);
+}
+
+/**
+ * Instant cards drawn by renderer don't keep faces, because they change too
+ * often, see `flipclock_card_animate()`.
+ */
+static bool _flipclock_card_draws_directly(const struct flipclock_card *card)
+{
+	RETURN_VAL_IF_FAIL(card != NULL, false);
+
+	return card->flip_duration == 0 && !card->cpu_compose;
+}
+
+/**
+ * Instant cards composed by CPU can't draw on window, drawing a whole face for
+ * each text is too slow, so they update text of their only face.
+ */
+static bool
+_flipclock_card_composes_in_place(const struct flipclock_card *card)
+{
+	RETURN_VAL_IF_FAIL(card != NULL, false);
+
+	return card->flip_duration == 0 && card->cpu_compose;
+}
+
+// Texts are keys to find faces, so they must be terminated.
+static void _flipclock_face_set_texts(struct flipclock_face *face,
+				      const char text[], const char sub_text[])
+{
+	RETURN_IF_FAIL(face != NULL);
+	RETURN_IF_FAIL(text != NULL);
+	RETURN_IF_FAIL(sub_text != NULL);
+
+	strncpy(face->text, text, MAX_TEXT_LENGTH - 1);
+	face->text[MAX_TEXT_LENGTH - 1] = '\0';
+	strncpy(face->sub_text, sub_text, MAX_TEXT_LENGTH - 1);
+	face->sub_text[MAX_TEXT_LENGTH - 1] = '\0';
+}
+
+/**
+ * A card only displays a small set of texts, so we keep drawn faces and a text
+ * change only needs to find its face. If there is no free slot, the least
+ * recently used face that is not displayed is redrawn. The prepared face is
+ * only given up when there is nothing else to reuse.
+ */
+static struct flipclock_tiles *
+_flipclock_card_get_face(struct flipclock_card *card, const char text[])
+{
+	RETURN_VAL_IF_FAIL(card != NULL, NULL);
+	RETURN_VAL_IF_FAIL(text != NULL, NULL);
+
+	const char *sub_text = card->has_sub_text ? card->sub_text : "";
+	++card->faces_tick;
+	for (int i = 0; i < card->faces_length; ++i) {
+		struct flipclock_face *face = &card->faces[i];
+		if (!strcmp(face->text, text) &&
+		    !strcmp(face->sub_text, sub_text)) {
+			face->used_tick = card->faces_tick;
+			return face->tiles;
+		}
+	}
+
+	/**
+	 * Instant cards composed by CPU only keep one face, and only compose
+	 * text of it again, it is not flipping so it can be changed in place.
+	 */
+	if (_flipclock_card_composes_in_place(card) && card->faces_length > 0) {
+		struct flipclock_face *face = &card->faces[0];
+		if (!strcmp(face->sub_text, sub_text))
+			_flipclock_card_compose_text(card, face->tiles,
+						     face->text, text);
+		else
+			_flipclock_card_draw_face(card, face->tiles, text);
+		_flipclock_face_set_texts(face, text, sub_text);
+		face->used_tick = card->faces_tick;
+		return face->tiles;
+	}
+
+	struct flipclock_face *face = NULL;
+	if (card->faces_length < card->faces_capacity) {
+		face = &card->faces[card->faces_length];
+		LOG_DEBUG("Creating new face with size `%dx%d`.\n",
+			  card->rect.w, card->rect.h);
+		const Uint64 trace_start = flipclock_trace_begin();
+		/**
+		 * Composed faces are written by CPU and uploaded once. A face
+		 * larger than max texture size is split into tiles.
+		 */
+		face->tiles = flipclock_tiles_create(
+			card->renderer,
+			card->cpu_compose ? SDL_PIXELFORMAT_ARGB8888 : 0,
+			card->cpu_compose ? SDL_TEXTUREACCESS_STREAMING :
+					    SDL_TEXTUREACCESS_TARGET,
+			card->rect.w, card->rect.h);
+		flipclock_tiles_set_blend_mode(face->tiles,
+					       SDL_BLENDMODE_BLEND);
+		flipclock_trace_end("_flipclock_card_create_face", trace_start);
+		++card->faces_length;
+	} else {
+		struct flipclock_face *next = NULL;
+		for (int i = 0; i < card->faces_length; ++i) {
+			struct flipclock_face *candidate = &card->faces[i];
+			// Never reuse faces that might be on screen.
+			if (candidate->tiles == card->current ||
+			    candidate->tiles == card->previous)
+				continue;
+			if (candidate->tiles == card->next) {
+				next = candidate;
+				continue;
+			}
+			if (face == NULL ||
+			    candidate->used_tick < face->used_tick)
+				face = candidate;
+		}
+		if (face == NULL) {
+			face = next;
+			card->next = NULL;
+		}
+	}
+	_flipclock_face_set_texts(face, text, sub_text);
+	face->used_tick = card->faces_tick;
+	_flipclock_card_draw_face(card, face->tiles, text);
+	return face->tiles;
 }
 
 // Those setter functions will request redraw.
@@ -289,8 +675,11 @@ void flipclock_card_set_rect(struct flipclock_card *card, const SDL_Rect rect)
 {
 	RETURN_IF_FAIL(card != NULL);
 
+	const Uint64 trace_start = flipclock_trace_begin();
 	card->divider_height = rect.h / 100;
 	card->radius = rect.h / 10;
+	if (2 * card->radius > rect.w)
+		card->radius = rect.w / 2;
 	card->sub_rect.h = rect.h / 10;
 	// Sub text's width is decide by the height.
 	card->sub_rect.w = card->sub_rect.h * strlen(card->sub_text);
@@ -300,14 +689,90 @@ void flipclock_card_set_rect(struct flipclock_card *card, const SDL_Rect rect)
 	// Reload textures and fonts if size changed.
 	SDL_Rect old_rect = card->rect;
 	card->rect = rect;
+	card->target_rect = rect;
 	if (card->rect.w != old_rect.w || card->rect.h != old_rect.h) {
-		_flipclock_card_close_fonts(card);
-		_flipclock_card_open_fonts(card);
-		_flipclock_card_destroy_textures(card);
-		_flipclock_card_create_textures(card);
+		_flipclock_card_close_font(card);
+		_flipclock_card_close_sub_font(card);
+		_flipclock_card_open_font(card);
+		if (card->has_sub_text)
+			_flipclock_card_open_sub_font(card);
+		// Keep displayed faces until new glyphs are ready.
+		if (card->current != NULL)
+			card->stale_faces = true;
+		else
+			_flipclock_card_destroy_faces(card);
+		_flipclock_card_create_corners(card);
+		/**
+		 * Faces are as large as the card, keep them under a memory
+		 * budget but at least have the current, previous and a free
+		 * one.
+		 */
+		card->faces_capacity = FACES_MEMORY_BUDGET /
+				       ((long long)rect.w * rect.h * 4 + 1);
+		if (card->faces_capacity < MIN_FACES)
+			card->faces_capacity = MIN_FACES;
+		if (card->faces_capacity > MAX_FACES)
+			card->faces_capacity = MAX_FACES;
 		// A redraw is requested because size changed.
 		card->should_redraw = true;
+		// The prepared face is in old size, draw it again.
+		card->should_prepare = card->next_text[0] != '\0';
+	}
+	flipclock_trace_end(__func__, trace_start);
+}
+
+// Switch how faces are drawn, all fonts and faces are reloaded for it.
+void flipclock_card_set_cpu_compose(struct flipclock_card *card,
+				    bool cpu_compose)
+{
+	RETURN_IF_FAIL(card != NULL);
+
+	if (card->cpu_compose == cpu_compose)
+		return;
+	card->cpu_compose = cpu_compose;
+	_flipclock_card_destroy_faces(card);
+	if (card->rect.w == 0 || card->rect.h == 0)
+		return;
+	_flipclock_card_close_font(card);
+	_flipclock_card_close_sub_font(card);
+	_flipclock_card_open_font(card);
+	if (card->has_sub_text)
+		_flipclock_card_open_sub_font(card);
+	_flipclock_card_create_corners(card);
+	card->should_redraw = true;
+	card->should_prepare = card->next_text[0] != '\0';
+}
+
+/**
+ * Only move and scale faces without redrawing them, this is cheap enough to
+ * call for every resize event, but faces look blurry until `set_rect()`.
+ */
+void flipclock_card_set_target_rect(struct flipclock_card *card,
+				    const SDL_Rect rect)
+{
+	RETURN_IF_FAIL(card != NULL);
+
+	// There is nothing to scale for a new card.
+	if (card->rect.w == 0 || card->rect.h == 0) {
+		flipclock_card_set_rect(card, rect);
+		return;
+	}
+	card->target_rect = rect;
+}
+
+void flipclock_card_set_flip_duration(struct flipclock_card *card,
+				      int flip_duration)
+{
+	RETURN_IF_FAIL(card != NULL);
+	RETURN_IF_FAIL(flip_duration >= 0);
+
+	card->flip_duration = flip_duration;
+	// Instant cards don't keep faces, or only keep one.
+	if (flipclock_card_is_instant(card)) {
+		_flipclock_card_destroy_faces(card);
+		card->should_prepare = false;
 	}
+	card->should_redraw = true;
 }
 
 void flipclock_card_set_text(struct flipclock_card *card, const char text[])
@@ -343,10 +808,14 @@ void flipclock_card_set_sub_text(struct flipclock_card *card,
 	if (sub_text == NULL) {
 		card->has_sub_text = false;
 		card->sub_text[0] = '\0';
+		_flipclock_card_close_sub_font(card);
 	} else {
 		card->has_sub_text = true;
 		strncpy(card->sub_text, sub_text, MAX_TEXT_LENGTH);
 		card->sub_text[MAX_TEXT_LENGTH - 1] = '\0';
+		// Font size depends on card size, so wait for it if not set.
+		if (card->sub_atlas == NULL && card->rect.h > 0)
+			_flipclock_card_open_sub_font(card);
 	}
 	// Sub text length might be changed so re-calculate it.
 	card->sub_rect.w = card->sub_rect.h * strlen(card->sub_text);
@@ -358,80 +827,252 @@ void flipclock_card_set_sub_text(struct flipclock_card *card,
 	card->should_redraw = true;
 }
 
+/**
+ * Text of the next time boundary is known before it comes, so the face can be
+ * drawn while the card is idle, then the flip only needs to find it.
+ */
+void flipclock_card_set_next_text(struct flipclock_card *card,
+				  const char next_text[])
+{
+	// Text can be NULL to drop the prepared face.
+	RETURN_IF_FAIL(card != NULL);
+
+	// Texts are sent on every tick, keep the prepared face if unchanged.
+	if (!strncmp(card->next_text, next_text != NULL ? next_text : "",
+		     MAX_TEXT_LENGTH - 1))
+		return;
+	if (next_text == NULL) {
+		card->next_text[0] = '\0';
+	} else {
+		strncpy(card->next_text, next_text, MAX_TEXT_LENGTH);
+		card->next_text[MAX_TEXT_LENGTH - 1] = '\0';
+	}
+	card->next = NULL;
+	card->should_prepare = card->next_text[0] != '\0';
+}
+
+// Returns true if a face is drawn, so caller can do one card at a time.
+bool flipclock_card_prepare(struct flipclock_card *card)
+{
+	RETURN_VAL_IF_FAIL(card != NULL, false);
+
+	// Wait until the card has a size and finishes its own redraw.
+	if (!card->should_prepare || card->should_redraw ||
+	    card->rect.w == 0 || card->rect.h == 0 ||
+	    flipclock_card_is_instant(card))
+		return false;
+	card->should_prepare = false;
+	if (!strcmp(card->next_text, card->text))
+		return false;
+	const Uint64 trace_start = flipclock_trace_begin();
+	card->next = _flipclock_card_get_face(card, card->next_text);
+	flipclock_trace_end(__func__, trace_start);
+	return true;
+}
+
 void flipclock_card_flip(struct flipclock_card *card)
 {
 	RETURN_IF_FAIL(card != NULL);
 
 	// Flipping animation start.
 	card->start_tick = SDL_GetTicks();
+	card->flipping = true;
+}
+
+// Glyphs are rasterized by workers, check them before drawing faces.
+static bool _flipclock_card_is_ready(struct flipclock_card *card)
+{
+	RETURN_VAL_IF_FAIL(card != NULL, false);
+
+	if (card->atlas != NULL && !flipclock_atlas_is_ready(card->atlas))
+		return false;
+	if (card->has_sub_text && card->sub_atlas != NULL &&
+	    !flipclock_atlas_is_ready(card->sub_atlas))
+		return false;
+	return true;
+}
+
+/**
+ * Returns true if all glyphs of the card are loaded from cache, it is only
+ * meaningful after atlases are ready.
+ */
+bool flipclock_card_is_cached(const struct flipclock_card *card)
+{
+	RETURN_VAL_IF_FAIL(card != NULL, false);
+
+	if (card->atlas == NULL || !card->atlas->cached)
+		return false;
+	if (card->has_sub_text && card->sub_atlas != NULL &&
+	    !card->sub_atlas->cached)
+		return false;
+	return true;
+}
+
+// Instant cards change text without flipping.
+bool flipclock_card_is_instant(const struct flipclock_card *card)
+{
+	RETURN_VAL_IF_FAIL(card != NULL, false);
+
+	return card->flip_duration == 0;
+}
+
+/**
+ * A card needs new frames if it has a pending redraw or it is flipping,
+ * including the last frame that shows the finished card.
+ */
+bool flipclock_card_is_animating(const struct flipclock_card *card)
+{
+	RETURN_VAL_IF_FAIL(card != NULL, false);
+
+	return card->should_redraw || card->flipping;
+}
+
+/**
+ * Instant cards like centiseconds change for almost every frame, keeping a
+ * face for each text churns faces, and a face of a 4K card is 16 MB. Parts
+ * are cheap to draw with renderer, so draw them on target every frame, like
+ * the target is a tile that the card is inside.
+ */
+static void _flipclock_card_draw_directly(struct flipclock_card *card)
+{
+	RETURN_IF_FAIL(card != NULL);
+
+	const Uint64 trace_start = flipclock_trace_begin();
+	/**
+	 * Parts are in size of `rect`, scale them to `target_rect` while
+	 * window is resizing, like faces are scaled by other cards.
+	 */
+	const bool scaled = card->rect.w > 0 && card->rect.h > 0 &&
+			    (card->target_rect.w != card->rect.w ||
+			     card->target_rect.h != card->rect.h);
+	float scale_x = 1.0f;
+	float scale_y = 1.0f;
+	if (scaled) {
+		scale_x = (float)card->target_rect.w / card->rect.w;
+		scale_y = (float)card->target_rect.h / card->rect.h;
+		SDL_RenderSetScale(card->renderer, scale_x, scale_y);
+	}
+	// Position of target in scaled coordinates.
+	const SDL_Rect tile_rect = {
+		-(int)(card->target_rect.x / scale_x + 0.5f),
+		-(int)(card->target_rect.y / scale_y + 0.5f), card->rect.w,
+		card->rect.h
+	};
+	// Corners are blended with target instead of replacing it.
+	if (card->corners != NULL)
+		SDL_SetTextureBlendMode(card->corners, SDL_BLENDMODE_BLEND);
+	_flipclock_card_draw_rounded_box(card, tile_rect);
+	if (card->corners != NULL)
+		SDL_SetTextureBlendMode(card->corners, SDL_BLENDMODE_NONE);
+	/**
+	 * Don't wait for workers, redraw is still pending, so text will be
+	 * drawn in a later frame.
+	 */
+	if (_flipclock_card_is_ready(card)) {
+		_flipclock_card_draw_text(card, tile_rect, card->text);
+		card->should_redraw = false;
+	}
+	_flipclock_card_draw_divider(card, tile_rect);
+	if (scaled)
+		SDL_RenderSetScale(card->renderer, 1.0f, 1.0f);
+	card->flipping = false;
+	flipclock_trace_end(__func__, trace_start);
 }
 
 void flipclock_card_animate(struct flipclock_card *card)
 {
 	RETURN_IF_FAIL(card != NULL);
 
+	if (_flipclock_card_draws_directly(card)) {
+		_flipclock_card_draw_directly(card);
+		return;
+	}
+
 	/**
 	 * We defer redraw requests to actually copy, so we only redraw card
 	 * once for different text changes.
 	 */
 	if (card->should_redraw) {
-		_flipclock_card_draw(card);
+		/**
+		 * Keep showing the old face until workers finish, instead of
+		 * waiting for them in this frame. Redraw is still pending, so
+		 * we will check it again in next frame.
+		 */
+		if (card->current != NULL && !_flipclock_card_is_ready(card)) {
+			flipclock_tiles_copy(card->current, NULL,
+					     &card->target_rect);
+			return;
+		}
+		if (card->stale_faces)
+			_flipclock_card_destroy_faces(card);
+		// Keep the old face for flipping animation.
+		card->previous = card->current;
+		card->current = _flipclock_card_get_face(card, card->text);
 		card->should_redraw = false;
+		// Prepared face is displayed now, it can be reused later.
+		if (card->current == card->next)
+			card->next = NULL;
 	}
 
 	// Do the flipping animation by copy card to window's given position.
 
 	long long progress = SDL_GetTicks() - card->start_tick;
-	// Don't animate when program just started.
-	if (progress >= MAX_PROGRESS || card->start_tick == 0) {
+	/**
+	 * Don't animate when program just started, or there is no previous
+	 * face because size changed.
+	 */
+	if (progress >= card->flip_duration || card->start_tick == 0 ||
+	    card->previous == NULL) {
 		// It finished flipping, so we don't draw flipping animation.
+		card->flipping = false;
 		// Card-local position.
 		SDL_Rect card_local_rect = { 0, 0, card->rect.w, card->rect.h };
-		SDL_RenderCopy(card->renderer, card->current, &card_local_rect,
-			       &card->rect);
+		flipclock_tiles_copy(card->current, &card_local_rect,
+				     &card->target_rect);
 		return;
 	}
 
+	const SDL_Rect target_rect = card->target_rect;
 	// Copy the upper current digit.
 	// Card-local position for source.
 	SDL_Rect half_source_rect = { 0, 0, card->rect.w, card->rect.h / 2 };
-	SDL_Rect half_target_rect = { card->rect.x, card->rect.y, card->rect.w,
-				      card->rect.h / 2 };
-	SDL_RenderCopy(card->renderer, card->current, &half_source_rect,
-		       &half_target_rect);
+	SDL_Rect half_target_rect = { target_rect.x, target_rect.y,
+				      target_rect.w, target_rect.h / 2 };
+	flipclock_tiles_copy(card->current, &half_source_rect,
+			     &half_target_rect);
 
 	// Copy the lower previous digit.
 	half_source_rect.y = card->rect.h / 2;
-	half_target_rect.y = card->rect.y + card->rect.h / 2;
-	SDL_RenderCopy(card->renderer, card->previous, &half_source_rect,
-		       &half_target_rect);
+	half_target_rect.y = target_rect.y + target_rect.h / 2;
+	flipclock_tiles_copy(card->previous, &half_source_rect,
+			     &half_target_rect);
 
 	/**
 	 * Copy the flipping part.
 	 * Upper half is previous and lower half is current.
 	 * Just custom the destination Rect, zoom will be done automatically.
 	 */
-	bool upper_half = progress <= HALF_PROGRESS;
-	double angle = upper_half ?
-			       PI * progress / MAX_PROGRESS :
-				     PI * (1.0 - (double)progress / MAX_PROGRESS);
+	bool upper_half = progress <= card->flip_duration / 2;
+	double angle = (double)progress / card->flip_duration;
+	angle = PI * (upper_half ? angle : 1.0 - angle);
 	double scale = cos(angle);
 	half_source_rect.y = upper_half ? 0 : card->rect.h / 2;
-	half_target_rect.y =
-		card->rect.y + (upper_half ?
-					(double)card->rect.h / 2 * (1 - scale) :
-					      (double)card->rect.h / 2);
-	half_target_rect.h = (double)card->rect.h / 2 * scale;
-	SDL_RenderCopy(card->renderer,
-		       upper_half ? card->previous : card->current,
-		       &half_source_rect, &half_target_rect);
+	half_target_rect.y = target_rect.y;
+	half_target_rect.y += upper_half ?
+				      (double)target_rect.h / 2 * (1 - scale) :
+				      (double)target_rect.h / 2;
+	half_target_rect.h = (double)target_rect.h / 2 * scale;
+	flipclock_tiles_copy(upper_half ? card->previous : card->current,
+			     &half_source_rect, &half_target_rect);
 }
 
 void flipclock_card_destory(struct flipclock_card *card)
 {
 	RETURN_IF_FAIL(card != NULL);
 
-	_flipclock_card_close_fonts(card);
-	_flipclock_card_destroy_textures(card);
+	_flipclock_card_close_font(card);
+	_flipclock_card_close_sub_font(card);
+	_flipclock_card_destroy_faces(card);
+	_flipclock_card_destroy_corners(card);
 	free(card);
 }
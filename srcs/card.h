@@ -6,34 +6,103 @@
 #include <SDL.h>
 #include <SDL_ttf.h>
 
+#include "tiles.h"
+
 // I am not creating a textarea.
 #define MAX_TEXT_LENGTH 8
+// 60 minutes or seconds, or 24 hours with ampm, plus some spare slots.
+#define MAX_FACES 64
+// Milliseconds of a flip by default.
+#define MAX_PROGRESS 300
+#define HALF_PROGRESS (MAX_PROGRESS / 2)
+
+// A drawn card for a given text, it is only valid for current card size.
+struct flipclock_face {
+	// Large faces are split into tiles, see `tiles.h`.
+	struct flipclock_tiles *tiles;
+	char text[MAX_TEXT_LENGTH];
+	char sub_text[MAX_TEXT_LENGTH];
+	long long used_tick;
+};
 
 struct flipclock_card {
 	struct flipclock *app;
 	SDL_Renderer *renderer;
-	SDL_Texture *current;
-	SDL_Texture *previous;
+	// They point to tiles of faces, so don't destroy them.
+	struct flipclock_tiles *current;
+	struct flipclock_tiles *previous;
+	// Face drawn ahead for `next_text`, it is kept until it is displayed.
+	struct flipclock_tiles *next;
+	struct flipclock_face faces[MAX_FACES];
+	int faces_length;
+	int faces_capacity;
+	long long faces_tick;
 	bool should_redraw;
+	/**
+	 * Faces are in old size, they are scaled until glyphs of new size are
+	 * rasterized by workers.
+	 */
+	bool stale_faces;
+	bool flipping;
 	long long start_tick;
+	/**
+	 * Milliseconds of a flip, 0 makes an instant card that changes text
+	 * without flipping.
+	 */
+	int flip_duration;
+	// Faces are drawn in this size.
 	SDL_Rect rect;
+	/**
+	 * Where faces are copied to, it only differs from `rect` while window
+	 * is resizing and old faces are scaled.
+	 */
+	SDL_Rect target_rect;
 	char text[MAX_TEXT_LENGTH];
-	TTF_Font *font;
+	// Text of the next time boundary, drawn by `prepare()` while idle.
+	char next_text[MAX_TEXT_LENGTH];
+	bool should_prepare;
 	bool has_sub_text;
 	SDL_Rect sub_rect;
 	char sub_text[MAX_TEXT_LENGTH];
-	TTF_Font *sub_font;
+	// Shared by cards of a clock, atlases are borrowed from it.
+	struct flipclock_atlases *atlases;
+	struct flipclock_atlas *atlas;
+	struct flipclock_atlas *sub_atlas;
 	int divider_height;
 	int radius;
+	// A circle with radius, quarters of it are copied as corners.
+	SDL_Texture *corners;
+	// Alpha of corners, used when composing faces by CPU.
+	Uint8 *corner_mask;
+	/**
+	 * Compose faces on CPU and upload them once, instead of drawing parts
+	 * with a software renderer.
+	 */
+	bool cpu_compose;
 };
 
 struct flipclock_card *flipclock_card_create(struct flipclock *app,
-					     SDL_Renderer *renderer);
+					     SDL_Renderer *renderer,
+					     struct flipclock_atlases *atlases);
 void flipclock_card_set_rect(struct flipclock_card *card, const SDL_Rect rect);
+void flipclock_card_set_target_rect(struct flipclock_card *card,
+				    const SDL_Rect rect);
+void flipclock_card_set_cpu_compose(struct flipclock_card *card,
+				    bool cpu_compose);
+void flipclock_card_set_flip_duration(struct flipclock_card *card,
+				      int flip_duration);
 void flipclock_card_set_text(struct flipclock_card *card, const char text[]);
 void flipclock_card_set_sub_text(struct flipclock_card *card,
 				 const char sub_text[]);
+void flipclock_card_set_next_text(struct flipclock_card *card,
+				  const char next_text[]);
+bool flipclock_card_prepare(struct flipclock_card *card);
+void flipclock_card_draw(struct flipclock_card *card,
+			 struct flipclock_tiles *target);
 void flipclock_card_flip(struct flipclock_card *card);
+bool flipclock_card_is_cached(const struct flipclock_card *card);
+bool flipclock_card_is_instant(const struct flipclock_card *card);
+bool flipclock_card_is_animating(const struct flipclock_card *card);
 void flipclock_card_animate(struct flipclock_card *card);
 void flipclock_card_destory(struct flipclock_card *card);
 
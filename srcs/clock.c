@@ -6,106 +6,662 @@
 #include <string.h>
 
 #include "flipclock.h"
+#include "atlas.h"
 #include "clock.h"
 #include "card.h"
+#include "counter.h"
+#include "queue.h"
+#include "font.h"
+#include "stats.h"
+#include "trace.h"
+#include "tiles.h"
 
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
+// Windows of different timezones are cascaded so they don't hide others.
+#define WINDOW_CASCADE 32
+// Redraw faces only if window size is not changed for this milliseconds.
+#define RESIZE_SETTLE_TIME 250
+// Timings change every frame, updating HUD texture slower makes it readable.
+#define HUD_INTERVAL 500
+#define MAX_HUD_LENGTH 512
+
+static void _flipclock_clock_place_card(struct flipclock_clock *clock,
+					struct flipclock_card *card,
+					SDL_Rect rect)
+{
+	RETURN_IF_FAIL(clock != NULL);
+	RETURN_IF_FAIL(card != NULL);
+
+	// Opening fonts and drawing faces for every resize event is too slow.
+	if (clock->resizing)
+		flipclock_card_set_target_rect(card, rect);
+	else
+		flipclock_card_set_rect(card, rect);
+}
 
 static void _flipclock_clock_update_layout(struct flipclock_clock *clock)
 {
 	RETURN_IF_FAIL(clock != NULL);
 
 	const struct flipclock *app = clock->app;
-	SDL_Rect hour_rect;
-	SDL_Rect minute_rect;
-	SDL_Rect second_rect;
-	int cards_length = app->show_second ? 3 : 2;
-	int spaces_length = cards_length + 1;
-	// space/card = 1/8.
+	// Layout is only updated when size changed, so we need a new frame.
+	clock->dirty = true;
+	clock->layer_valid = false;
+	flipclock_layout_update(&clock->layout, clock->w, clock->h,
+				clock->cards_length, app->card_scale);
+	for (int i = 0; i < clock->cards_length; ++i)
+		_flipclock_clock_place_card(clock, clock->cards[i],
+					    clock->layout.rects[i]);
+}
+
+static int
+_flipclock_clock_get_cards_length(const struct flipclock_clock *clock)
+{
+	RETURN_VAL_IF_FAIL(clock != NULL, 0);
+
+	if (clock->app->counter)
+		return COUNTER_CARDS;
+	return clock->show_second ? FLIPCLOCK_CARD_SECOND + 1 :
+				    FLIPCLOCK_CARD_MINUTE + 1;
+}
+
+// New cards have no rects, so update layout after this.
+static void _flipclock_clock_set_cards_length(struct flipclock_clock *clock,
+					      int cards_length)
+{
+	RETURN_IF_FAIL(clock != NULL);
+	RETURN_IF_FAIL(cards_length >= 0 && cards_length <= MAX_CARDS);
+
+	for (int i = cards_length; i < clock->cards_length; ++i) {
+		flipclock_card_destory(clock->cards[i]);
+		clock->cards[i] = NULL;
+	}
+	for (int i = clock->cards_length; i < cards_length; ++i)
+		clock->cards[i] = flipclock_card_create(
+			clock->app, clock->renderer, clock->atlases);
+	clock->cards_length = cards_length;
+}
+
+// Returns NULL if the card is not shown.
+static struct flipclock_card *
+_flipclock_clock_get_card(const struct flipclock_clock *clock, int card_i)
+{
+	RETURN_VAL_IF_FAIL(clock != NULL, NULL);
+
+	if (card_i < 0 || card_i >= clock->cards_length)
+		return NULL;
+	return clock->cards[card_i];
+}
+
+/**
+ * Counter changes by itself, so texts of cards are set from its value before
+ * every frame, and only cards with changed texts are redrawn.
+ */
+static void _flipclock_clock_update_counter(struct flipclock_clock *clock)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	if (!clock->app->counter || clock->cards_length < COUNTER_CARDS)
+		return;
+	// The last change of a countdown also flips.
+	const bool running = clock->counter.running;
+	const long long value = flipclock_counter_update(
+		&clock->counter, SDL_GetPerformanceCounter());
+	char texts[COUNTER_CARDS][MAX_TEXT_LENGTH];
+	flipclock_counter_format(value, texts);
+	for (int i = 0; i < COUNTER_CARDS; ++i) {
+		struct flipclock_card *card = clock->cards[i];
+		if (!strcmp(card->text, texts[i]))
+			continue;
+		flipclock_card_set_text(card, texts[i]);
+		// Don't flip when it is reset.
+		if (running)
+			flipclock_card_flip(card);
+	}
+}
+
+static void _flipclock_clock_create_cards(struct flipclock_clock *clock)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	struct flipclock *app = clock->app;
+
+	// Renderer is created while workers are loading fonts.
+	flipclock_wait_resources(app);
+	const Uint64 trace_start = flipclock_trace_begin();
+	clock->atlases =
+		flipclock_atlases_create(clock->renderer, app->fonts,
+					 app->cache, app->sdf,
+					 app->text_color, app->workers);
+	_flipclock_clock_set_cards_length(
+		clock, _flipclock_clock_get_cards_length(clock));
+	// Centiseconds change too fast to flip, other cards still flip.
+	if (app->counter) {
+		flipclock_card_set_flip_duration(
+			clock->cards[FLIPCLOCK_COUNTER_CENTISECOND], 0);
+		_flipclock_clock_update_counter(clock);
+	}
+	_flipclock_clock_update_layout(clock);
+	flipclock_trace_end(__func__, trace_start);
+}
+
+static void _flipclock_clock_destroy_cards(struct flipclock_clock *clock)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	_flipclock_clock_set_cards_length(clock, 0);
+	// Cards closed all atlases.
+	flipclock_atlases_destroy(clock->atlases);
+	clock->atlases = NULL;
+}
+
+// Renderer must be created in the thread that uses it.
+static void _flipclock_clock_create_renderer(struct flipclock_clock *clock)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	const Uint64 trace_start = flipclock_trace_begin();
+	clock->renderer = SDL_CreateRenderer(
+		clock->window, -1,
+		SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE |
+			SDL_RENDERER_PRESENTVSYNC);
+	if (clock->renderer == NULL) {
+		LOG_ERROR("%s\n", SDL_GetError());
+		exit(EXIT_FAILURE);
+	}
+	SDL_SetRenderDrawBlendMode(clock->renderer, SDL_BLENDMODE_BLEND);
+	// Missed vsyncs are counted with refresh rate of the display.
+	SDL_DisplayMode mode;
+	if (SDL_GetWindowDisplayMode(clock->window, &mode) < 0)
+		mode.refresh_rate = 0;
+	flipclock_stats_init(&clock->stats, mode.refresh_rate);
+	flipclock_trace_end(__func__, trace_start);
+}
+
+static void _flipclock_clock_set_show_hud(struct flipclock_clock *clock,
+					  bool show_hud)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	struct flipclock *app = clock->app;
+	clock->show_hud = show_hud;
+	// Window needs redrawing to show or hide HUD.
+	clock->dirty = true;
+	if (clock->hud != NULL) {
+		SDL_DestroyTexture(clock->hud);
+		clock->hud = NULL;
+	}
+	if (clock->hud_font != NULL) {
+		flipclock_fonts_close(app->fonts, clock->hud_font);
+		clock->hud_font = NULL;
+	}
+	if (show_hud) {
+		int size = clock->h / 40;
+		if (size < 12)
+			size = 12;
+		clock->hud_font = flipclock_fonts_open(app->fonts, size);
+	}
+}
+
+static void _flipclock_clock_draw_hud(struct flipclock_clock *clock)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	struct flipclock *app = clock->app;
+	if (clock->hud == NULL ||
+	    SDL_GetTicks() - clock->hud_tick >= HUD_INTERVAL) {
+		char text[MAX_HUD_LENGTH];
+		flipclock_stats_format(&clock->stats, text, MAX_HUD_LENGTH);
+		flipclock_fonts_lock(app->fonts);
+		SDL_Surface *surface = TTF_RenderUTF8_Blended_Wrapped(
+			clock->hud_font, text, app->text_color, clock->w);
+		flipclock_fonts_unlock(app->fonts);
+		if (surface == NULL) {
+			LOG_ERROR("%s\n", TTF_GetError());
+			exit(EXIT_FAILURE);
+		}
+		if (clock->hud != NULL)
+			SDL_DestroyTexture(clock->hud);
+		clock->hud = SDL_CreateTextureFromSurface(clock->renderer,
+							  surface);
+		SDL_FreeSurface(surface);
+		if (clock->hud == NULL) {
+			LOG_ERROR("%s\n", SDL_GetError());
+			exit(EXIT_FAILURE);
+		}
+		clock->hud_tick = SDL_GetTicks();
+	}
+	SDL_Rect hud_rect = { 0, 0, 0, 0 };
+	SDL_QueryTexture(clock->hud, NULL, NULL, &hud_rect.w, &hud_rect.h);
+	// Draw over cards with a translucent box so text is readable.
+	SDL_Rect back_rect = hud_rect;
+	back_rect.w += hud_rect.h / 4;
+	back_rect.h += hud_rect.h / 4;
+	hud_rect.x = back_rect.w / 2 - hud_rect.w / 2;
+	hud_rect.y = back_rect.h / 2 - hud_rect.h / 2;
+	SDL_SetRenderDrawColor(clock->renderer, app->box_color.r,
+			       app->box_color.g, app->box_color.b, 0xc0);
+	SDL_RenderFillRect(clock->renderer, &back_rect);
+	SDL_RenderCopy(clock->renderer, clock->hud, NULL, &hud_rect);
+}
+
+// Destroy everything created by the thread that renders the clock.
+static void _flipclock_clock_destroy_renderer(struct flipclock_clock *clock)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	_flipclock_clock_set_show_hud(clock, false);
+	if (clock->layer != NULL)
+		SDL_DestroyTexture(clock->layer);
+	SDL_DestroyRenderer(clock->renderer);
+}
+
+static void _flipclock_clock_set_text(struct flipclock_card *card,
+				      const struct flipclock_message *message)
+{
+	RETURN_IF_FAIL(card != NULL);
+	RETURN_IF_FAIL(message != NULL);
+
+	flipclock_card_set_text(card, message->has_text ? message->text : NULL);
+	if (message->flag)
+		flipclock_card_flip(card);
+}
+
+static void _flipclock_clock_set_show_second(struct flipclock_clock *clock,
+					     bool show_second)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	clock->show_second = show_second;
+	_flipclock_clock_set_cards_length(
+		clock, _flipclock_clock_get_cards_length(clock));
+	// Toggling seconds always changes size.
+	_flipclock_clock_update_layout(clock);
+}
+
+static void _flipclock_clock_resize(struct flipclock_clock *clock, int w, int h)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
 	/**
-	 * In best condition, we have 1 + 8 + 1 + 8 + 1. However, the other
-	 * length of window might be smaller, and the card is less than 8. We
-	 * will enlarge the spaces of begining and end, so only care about
-	 * spaces between cards when calculating position.
+	 * Only re-render when size changed.
+	 * Windows may send event when size
+	 * not changed, and cause strange bugs.
 	 */
-	if (clock->w >= clock->h) {
-		int space_size = clock->w / (cards_length * 8 + spaces_length);
-		int min_height = clock->h * 0.8;
-		int min_width =
-			clock->w * 8 / (cards_length * 8 + spaces_length);
-		int card_size = min_height < min_width ? min_height : min_width;
-		card_size *= app->card_scale;
-
-		hour_rect.x = (clock->w - card_size * cards_length -
-			       space_size * (spaces_length - 2)) /
-			      2;
-		hour_rect.y = (clock->h - card_size) / 2;
-		hour_rect.w = card_size;
-		hour_rect.h = card_size;
-		flipclock_card_set_rect(clock->hour, hour_rect);
-
-		minute_rect.x = hour_rect.x + hour_rect.w + space_size;
-		minute_rect.y = hour_rect.y;
-		minute_rect.w = card_size;
-		minute_rect.h = card_size;
-		flipclock_card_set_rect(clock->minute, minute_rect);
-
-		if (app->show_second) {
-			second_rect.x = hour_rect.x + hour_rect.w + space_size +
-					minute_rect.w + space_size;
-			second_rect.y = hour_rect.y;
-			second_rect.w = card_size;
-			second_rect.h = card_size;
-			flipclock_card_set_rect(clock->second, second_rect);
+	if (w == clock->w && h == clock->h)
+		return;
+	clock->w = w;
+	clock->h = h;
+	LOG_DEBUG("New window size for clock `%d` is `%dx%d`.\n", clock->i,
+		  clock->w, clock->h);
+	// Dragging sends many events, only the last one in a frame matters.
+	clock->layout_pending = true;
+	clock->resizing = true;
+	clock->resize_tick = SDL_GetTicks();
+}
+
+// Milliseconds before we redraw faces for new size, or -1 if not resizing.
+static int
+_flipclock_clock_get_resize_timeout(const struct flipclock_clock *clock)
+{
+	RETURN_VAL_IF_FAIL(clock != NULL, -1);
+
+	if (!clock->resizing)
+		return -1;
+	int timeout = RESIZE_SETTLE_TIME -
+		      (int)(SDL_GetTicks() - clock->resize_tick);
+	return timeout < 0 ? 0 : timeout;
+}
+
+static void
+_flipclock_clock_handle_message(struct flipclock_clock *clock,
+				const struct flipclock_message *message)
+{
+	RETURN_IF_FAIL(clock != NULL);
+	RETURN_IF_FAIL(message != NULL);
+
+	struct flipclock_card *card =
+		_flipclock_clock_get_card(clock, message->card_i);
+	const char *text = message->has_text ? message->text : NULL;
+	switch (message->type) {
+	case FLIPCLOCK_MESSAGE_TEXT:
+		if (card != NULL)
+			_flipclock_clock_set_text(card, message);
+		break;
+	case FLIPCLOCK_MESSAGE_SUB_TEXT:
+		// Set sub text should never flip a card.
+		if (card != NULL)
+			flipclock_card_set_sub_text(card, text);
+		break;
+	case FLIPCLOCK_MESSAGE_NEXT_TEXT:
+		if (card != NULL)
+			flipclock_card_set_next_text(card, text);
+		break;
+	case FLIPCLOCK_MESSAGE_SHOW_SECOND:
+		_flipclock_clock_set_show_second(clock, message->flag);
+		break;
+	case FLIPCLOCK_MESSAGE_SHOW_HUD:
+		_flipclock_clock_set_show_hud(clock, message->flag);
+		break;
+	case FLIPCLOCK_MESSAGE_RESIZE:
+		_flipclock_clock_resize(clock, message->w, message->h);
+		break;
+	case FLIPCLOCK_MESSAGE_EXPOSE:
+		clock->dirty = true;
+		// Some backends lose render targets with window content.
+		clock->layer_valid = false;
+		break;
+	case FLIPCLOCK_MESSAGE_WAIT:
+		clock->waiting = message->flag;
+		// Window content might be lost while waiting.
+		clock->dirty = true;
+		clock->layer_valid = false;
+		break;
+	case FLIPCLOCK_MESSAGE_TOGGLE_COUNTER:
+		flipclock_counter_toggle(&clock->counter, message->tick);
+		break;
+	case FLIPCLOCK_MESSAGE_RESET_COUNTER:
+		flipclock_counter_reset(&clock->counter);
+		break;
+	case FLIPCLOCK_MESSAGE_QUIT:
+		clock->running = false;
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Main thread handles messages of clocks that it renders when their queues are
+ * full, it can't wait for itself to drain them.
+ */
+static void
+_flipclock_clock_handle_queued(void *data,
+			       const struct flipclock_message *message)
+{
+	_flipclock_clock_handle_message(data, message);
+}
+
+static void _flipclock_clock_dispatch(struct flipclock_clock *clock)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	struct flipclock_message message;
+	while (flipclock_queue_pop(clock->queue, &message))
+		_flipclock_clock_handle_message(clock, &message);
+	if (clock->layout_pending) {
+		clock->layout_pending = false;
+		_flipclock_clock_update_layout(clock);
+	}
+	if (_flipclock_clock_get_resize_timeout(clock) == 0) {
+		LOG_DEBUG("Window size of clock `%d` is settled.\n", clock->i);
+		clock->resizing = false;
+		_flipclock_clock_update_layout(clock);
+	}
+	_flipclock_clock_update_counter(clock);
+}
+
+static bool _flipclock_clock_needs_frame(const struct flipclock_clock *clock)
+{
+	RETURN_VAL_IF_FAIL(clock != NULL, false);
+
+	// Pause when minimized.
+	if (clock->waiting)
+		return false;
+	if (clock->dirty)
+		return true;
+	// Running counter changes for every frame.
+	if (clock->counter.running)
+		return true;
+	for (int i = 0; i < clock->cards_length; ++i)
+		if (flipclock_card_is_animating(clock->cards[i]))
+			return true;
+	return false;
+}
+
+static void _flipclock_clock_update_layer(struct flipclock_clock *clock,
+					  unsigned int layer_cards)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	const Uint64 trace_start = flipclock_trace_begin();
+	const struct flipclock *app = clock->app;
+	int w;
+	int h;
+	SDL_GetRendererOutputSize(clock->renderer, &w, &h);
+	int layer_w = 0;
+	int layer_h = 0;
+	if (clock->layer != NULL)
+		SDL_QueryTexture(clock->layer, NULL, NULL, &layer_w, &layer_h);
+	if (clock->layer == NULL || layer_w != w || layer_h != h) {
+		LOG_DEBUG("Creating layer for clock `%d` with size `%dx%d`.\n",
+			  clock->i, w, h);
+		if (clock->layer != NULL)
+			SDL_DestroyTexture(clock->layer);
+		clock->layer = SDL_CreateTexture(
+			clock->renderer, 0, SDL_TEXTUREACCESS_TARGET, w, h);
+		if (clock->layer == NULL) {
+			LOG_ERROR("%s\n", SDL_GetError());
+			exit(EXIT_FAILURE);
 		}
+		// Layer covers the whole window, so just replace old pixels.
+		SDL_SetTextureBlendMode(clock->layer, SDL_BLENDMODE_NONE);
+	}
+
+	SDL_SetRenderTarget(clock->renderer, clock->layer);
+	SDL_SetRenderDrawColor(clock->renderer, app->background_color.r,
+			       app->background_color.g, app->background_color.b,
+			       app->background_color.a);
+	SDL_RenderClear(clock->renderer);
+	// Idle cards only copy their current faces, so target is not changed.
+	for (int i = 0; i < clock->cards_length; ++i)
+		if (layer_cards & (1u << i))
+			flipclock_card_animate(clock->cards[i]);
+	SDL_SetRenderTarget(clock->renderer, NULL);
+	clock->layer_cards = layer_cards;
+	clock->layer_valid = true;
+	flipclock_trace_end(__func__, trace_start);
+}
+
+/**
+ * Time to first frame is mostly opening fonts and rasterizing glyphs, so tell
+ * whether glyphs were loaded from cache.
+ */
+static void
+_flipclock_clock_report_first_frame(struct flipclock_clock *clock,
+				    Uint64 presented)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	bool cached = true;
+	for (int i = 0; i < clock->cards_length; ++i)
+		if (!flipclock_card_is_cached(clock->cards[i]))
+			cached = false;
+	const struct flipclock *app = clock->app;
+	flipclock_stats_set_first_frame(&clock->stats, app->start_counter,
+					presented, cached);
+	flipclock_trace_end("first_frame", app->start_counter);
+	LOG_DEBUG("Clock `%d` presented first frame in `%.2f` ms, %s start.\n",
+		  clock->i, clock->stats.first_frame_us / 1000.0,
+		  cached ? "warm" : "cold");
+}
+
+static void _flipclock_clock_render(struct flipclock_clock *clock)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	// Don't present the same frame again if nothing changed.
+	if (!_flipclock_clock_needs_frame(clock))
+		return;
+
+	const Uint64 start = SDL_GetPerformanceCounter();
+	clock->frame_tick = SDL_GetTicks();
+	unsigned int idle_cards = 0;
+	for (int i = 0; i < clock->cards_length; ++i) {
+		const struct flipclock_card *card = clock->cards[i];
+		// Instant cards change too often to be kept in layer.
+		if (!flipclock_card_is_animating(card) &&
+		    !flipclock_card_is_instant(card))
+			idle_cards |= 1u << i;
+	}
+	int w;
+	int h;
+	SDL_GetRendererOutputSize(clock->renderer, &w, &h);
+	unsigned int layer_cards = idle_cards;
+	if (flipclock_tiles_fit(clock->renderer, w, h)) {
+		/**
+		 * Layer is only updated when a card starts or stops animating,
+		 * then frames of a flip only copy layer and draw one card.
+		 */
+		if (!clock->layer_valid || idle_cards != clock->layer_cards)
+			_flipclock_clock_update_layer(clock, idle_cards);
+		SDL_RenderCopy(clock->renderer, clock->layer, NULL, NULL);
 	} else {
-		int space_size = clock->h / (cards_length * 8 + spaces_length);
-		int min_width = clock->w * 0.8;
-		int min_height =
-			clock->h * 8 / (cards_length * 8 + spaces_length);
-		int card_size = min_height < min_width ? min_height : min_width;
-		card_size *= app->card_scale;
-
-		hour_rect.x = (clock->w - card_size) / 2;
-		hour_rect.y = (clock->h - card_size * cards_length -
-			       space_size * (spaces_length - 2)) /
-			      2;
-		hour_rect.w = card_size;
-		hour_rect.h = card_size;
-		flipclock_card_set_rect(clock->hour, hour_rect);
-
-		minute_rect.y = hour_rect.y + hour_rect.h + space_size;
-		minute_rect.x = hour_rect.x;
-		minute_rect.w = card_size;
-		minute_rect.h = card_size;
-		flipclock_card_set_rect(clock->minute, minute_rect);
-
-		if (app->show_second) {
-			second_rect.y = hour_rect.y + hour_rect.h + space_size +
-					minute_rect.h + space_size;
-			second_rect.x = hour_rect.x;
-			second_rect.w = card_size;
-			second_rect.h = card_size;
-			flipclock_card_set_rect(clock->second, second_rect);
-		}
+		/**
+		 * Window is larger than max texture size so there is no
+		 * layer, draw background and all cards for every frame.
+		 */
+		const struct flipclock *app = clock->app;
+		SDL_SetRenderDrawColor(clock->renderer, app->background_color.r,
+				       app->background_color.g,
+				       app->background_color.b,
+				       app->background_color.a);
+		SDL_RenderClear(clock->renderer);
+		layer_cards = 0;
+		clock->layer_valid = false;
 	}
+	for (int i = 0; i < clock->cards_length; ++i)
+		if (!(layer_cards & (1u << i)))
+			flipclock_card_animate(clock->cards[i]);
+	if (clock->show_hud)
+		_flipclock_clock_draw_hud(clock);
+	/**
+	 * Check it after cards are animated, the frame that finishes a flip
+	 * is not followed by another one until the next flip.
+	 */
+	bool animating = clock->counter.running;
+	for (int i = 0; i < clock->cards_length; ++i)
+		if (flipclock_card_is_animating(clock->cards[i]))
+			animating = true;
+
+	const Uint64 drawn = SDL_GetPerformanceCounter();
+	const Uint64 trace_start = flipclock_trace_begin();
+	SDL_RenderPresent(clock->renderer);
+	flipclock_trace_end("SDL_RenderPresent", trace_start);
+	const Uint64 presented = SDL_GetPerformanceCounter();
+	flipclock_stats_add_frame(&clock->stats, start, drawn, presented,
+				  animating);
+	if (clock->stats.first_frame_us == 0)
+		_flipclock_clock_report_first_frame(clock, presented);
+	clock->dirty = false;
 }
 
-static void _flipclock_clock_create_cards(struct flipclock_clock *clock)
+/**
+ * Draw faces of the next time boundary after a flip finishes, so the next flip
+ * only copies them. Skip it while resizing, because faces are redrawn once
+ * size is settled.
+ */
+static void _flipclock_clock_prepare(struct flipclock_clock *clock)
 {
 	RETURN_IF_FAIL(clock != NULL);
 
-	struct flipclock *app = clock->app;
+	if (clock->waiting || clock->resizing ||
+	    _flipclock_clock_needs_frame(clock))
+		return;
+	for (int i = 0; i < clock->cards_length; ++i)
+		flipclock_card_prepare(clock->cards[i]);
+}
 
-	clock->hour = flipclock_card_create(app, clock->renderer);
-	clock->minute = flipclock_card_create(app, clock->renderer);
-	clock->second = NULL;
-	if (app->show_second)
-		clock->second = flipclock_card_create(app, clock->renderer);
-	_flipclock_clock_update_layout(clock);
+/**
+ * Vsync blocks presenting so we don't need to wait, this only limits FPS to
+ * refresh rate if vsync does not work, so fast displays get all frames.
+ */
+static int
+_flipclock_clock_get_frame_timeout(const struct flipclock_clock *clock)
+{
+	RETURN_VAL_IF_FAIL(clock != NULL, 0);
+
+	const int timeout = 1000 / clock->stats.refresh_rate -
+			    (int)(SDL_GetTicks() - clock->frame_tick);
+	return timeout > 0 ? timeout : 0;
+}
+
+/**
+ * Each clock renders in its own thread when enabled, so clocks with vsync
+ * won't block each other when presenting.
+ */
+static int _flipclock_clock_run(void *data)
+{
+	struct flipclock_clock *clock = data;
+
+	_flipclock_clock_create_renderer(clock);
+	_flipclock_clock_create_cards(clock);
+	while (clock->running) {
+		int timeout = -1;
+		if (_flipclock_clock_needs_frame(clock))
+			timeout = _flipclock_clock_get_frame_timeout(clock);
+		// Wake up to redraw faces after resizing.
+		const int resize_timeout =
+			_flipclock_clock_get_resize_timeout(clock);
+		if (resize_timeout >= 0 &&
+		    (timeout < 0 || resize_timeout < timeout))
+			timeout = resize_timeout;
+		flipclock_queue_wait(clock->queue, timeout);
+		_flipclock_clock_dispatch(clock);
+		_flipclock_clock_render(clock);
+		_flipclock_clock_prepare(clock);
+	}
+	_flipclock_clock_destroy_cards(clock);
+	_flipclock_clock_destroy_renderer(clock);
+	return 0;
 }
 
+static struct flipclock_clock *_flipclock_clock_new(struct flipclock *app,
+						    int i)
+{
+	RETURN_VAL_IF_FAIL(app != NULL, NULL);
+
+	struct flipclock_clock *clock = malloc(sizeof(*clock));
+	if (clock == NULL) {
+		LOG_ERROR("Failed to create clock!");
+		exit(EXIT_FAILURE);
+	}
+	clock->app = app;
+	clock->window = NULL;
+	clock->renderer = NULL;
+	clock->atlases = NULL;
+	memset(clock->cards, 0, sizeof(clock->cards));
+	clock->thread = NULL;
+	clock->queue = flipclock_queue_create();
+	clock->i = i;
+	clock->zone = NULL;
+	memset(&clock->now, 0, sizeof(clock->now));
+	clock->w = 0;
+	clock->h = 0;
+	clock->cards_length = 0;
+	flipclock_layout_init(&clock->layout);
+	clock->show_second = app->show_second;
+	flipclock_counter_init(&clock->counter, app->countdown);
+	clock->waiting = false;
+	clock->dirty = true;
+	clock->layout_pending = false;
+	clock->resizing = false;
+	clock->resize_tick = 0;
+	clock->running = true;
+	clock->frame_tick = 0;
+	clock->layer = NULL;
+	clock->layer_cards = 0;
+	clock->layer_valid = false;
+	flipclock_stats_init(&clock->stats, DEFAULT_REFRESH_RATE);
+	clock->show_hud = false;
+	clock->hud_font = NULL;
+	clock->hud = NULL;
+	clock->hud_tick = 0;
+	return clock;
+}
+
+// Window must be created in main thread, because it handles events.
 struct flipclock_clock *flipclock_clock_create(struct flipclock *app, int i)
 {
 	RETURN_VAL_IF_FAIL(app != NULL, NULL);
@@ -129,16 +685,11 @@ struct flipclock_clock *flipclock_clock_create(struct flipclock *app, int i)
 #endif
 			SDL_WINDOW_FULLSCREEN_DESKTOP;
 	}
-	struct flipclock_clock *clock = malloc(sizeof(*clock));
-	if (clock == NULL) {
-		LOG_ERROR("Failed to create clock!");
-		exit(EXIT_FAILURE);
-	}
-	clock->app = app;
-	clock->waiting = false;
-	clock->i = i;
+	const Uint64 trace_start = flipclock_trace_begin();
+	struct flipclock_clock *clock = _flipclock_clock_new(app, i);
 	SDL_Rect display_bounds;
-	SDL_GetDisplayBounds(i, &display_bounds);
+	// Only fullscreen clocks have their own displays.
+	SDL_GetDisplayBounds(app->full ? i : 0, &display_bounds);
 	// Give each window a unique title.
 	char window_title[MAX_BUFFER_LENGTH];
 	snprintf(window_title, MAX_BUFFER_LENGTH, PROGRAM_TITLE " %d", i);
@@ -151,9 +702,11 @@ struct flipclock_clock *flipclock_clock_create(struct flipclock *app, int i)
 		clock->window = SDL_CreateWindow(
 			window_title,
 			display_bounds.x +
-				(display_bounds.w - WINDOW_WIDTH) / 2,
+				(display_bounds.w - WINDOW_WIDTH) / 2 +
+				i * WINDOW_CASCADE,
 			display_bounds.y +
-				(display_bounds.h - WINDOW_HEIGHT) / 2,
+				(display_bounds.h - WINDOW_HEIGHT) / 2 +
+				i * WINDOW_CASCADE,
 			WINDOW_WIDTH, WINDOW_HEIGHT, flags);
 	if (clock->window == NULL) {
 		LOG_ERROR("%s\n", SDL_GetError());
@@ -161,36 +714,34 @@ struct flipclock_clock *flipclock_clock_create(struct flipclock *app, int i)
 	}
 	// Get actual window size after create it.
 	SDL_GetWindowSize(clock->window, &clock->w, &clock->h);
-	clock->renderer = SDL_CreateRenderer(
-		clock->window, -1,
-		SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE |
-			SDL_RENDERER_PRESENTVSYNC);
-	if (clock->renderer == NULL) {
-		LOG_ERROR("%s\n", SDL_GetError());
-		exit(EXIT_FAILURE);
+	if (app->render_threads) {
+		clock->thread = SDL_CreateThread(_flipclock_clock_run,
+						 "flipclock-clock", clock);
+		if (clock->thread == NULL) {
+			LOG_ERROR("%s\n", SDL_GetError());
+			exit(EXIT_FAILURE);
+		}
+	} else {
+		flipclock_queue_set_handle(clock->queue,
+					   _flipclock_clock_handle_queued,
+					   clock);
+		_flipclock_clock_create_renderer(clock);
+		_flipclock_clock_create_cards(clock);
 	}
-	SDL_SetRenderDrawBlendMode(clock->renderer, SDL_BLENDMODE_BLEND);
-	_flipclock_clock_create_cards(clock);
+	flipclock_trace_end(__func__, trace_start);
 	return clock;
 }
 
 #if defined(_WIN32)
 /**
  * Create clock from given HWND, which should be a subwindow of screensaver
- * preview.
+ * preview. Preview always renders in main thread.
  */
 struct flipclock_clock *flipclock_clock_create_preview(struct flipclock *app)
 {
 	RETURN_VAL_IF_FAIL(app != NULL, NULL);
 
-	struct flipclock_clock *clock = malloc(sizeof(*clock));
-	if (clock == NULL) {
-		LOG_ERROR("Failed to create clock!");
-		exit(EXIT_FAILURE);
-	}
-	clock->app = app;
-	clock->waiting = false;
-	clock->i = 0;
+	struct flipclock_clock *clock = _flipclock_clock_new(app, 0);
 	clock->window = SDL_CreateWindowFrom(app->preview_window);
 	if (clock->window == NULL) {
 		LOG_ERROR("%s\n", SDL_GetError());
@@ -198,37 +749,79 @@ struct flipclock_clock *flipclock_clock_create_preview(struct flipclock *app)
 	}
 	// Get actual window size after create it.
 	SDL_GetWindowSize(clock->window, &clock->w, &clock->h);
-	clock->renderer = SDL_CreateRenderer(
-		clock->window, -1,
-		SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE |
-			SDL_RENDERER_PRESENTVSYNC);
-	if (clock->renderer == NULL) {
-		LOG_ERROR("%s\n", SDL_GetError());
-		exit(EXIT_FAILURE);
-	}
-	SDL_SetRenderDrawBlendMode(clock->renderer, SDL_BLENDMODE_BLEND);
+	flipclock_queue_set_handle(clock->queue, _flipclock_clock_handle_queued,
+				   clock);
+	_flipclock_clock_create_renderer(clock);
 	_flipclock_clock_create_cards(clock);
 	return clock;
 }
 #endif
 
+static void _flipclock_clock_post_text(struct flipclock_clock *clock,
+				       enum flipclock_message_type type,
+				       int card_i, const char text[], bool flag)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	struct flipclock_message message;
+	message.type = type;
+	message.card_i = card_i;
+	message.has_text = text != NULL;
+	message.text[0] = '\0';
+	if (text != NULL) {
+		strncpy(message.text, text, MAX_TEXT_LENGTH);
+		message.text[MAX_TEXT_LENGTH - 1] = '\0';
+	}
+	message.flag = flag;
+	message.w = 0;
+	message.h = 0;
+	message.tick = 0;
+	flipclock_queue_push(clock->queue, &message);
+}
+
+static void _flipclock_clock_post(struct flipclock_clock *clock,
+				  enum flipclock_message_type type,
+				  const char text[], bool flag)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	_flipclock_clock_post_text(clock, type, -1, text, flag);
+}
+
+static void _flipclock_clock_post_resize(struct flipclock_clock *clock)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	struct flipclock_message message;
+	message.type = FLIPCLOCK_MESSAGE_RESIZE;
+	message.card_i = -1;
+	message.has_text = false;
+	message.text[0] = '\0';
+	message.flag = false;
+	SDL_GetWindowSize(clock->window, &message.w, &message.h);
+	message.tick = 0;
+	flipclock_queue_push(clock->queue, &message);
+}
+
+/**
+ * Those setter functions are called in main thread, they only send messages
+ * to the thread that renders the clock.
+ */
 void flipclock_clock_set_show_second(struct flipclock_clock *clock,
 				     bool show_second)
 {
 	RETURN_IF_FAIL(clock != NULL);
 
-	if (show_second) {
-		if (clock->second == NULL)
-			clock->second = flipclock_card_create(clock->app,
-							      clock->renderer);
-	} else {
-		if (clock->second != NULL) {
-			flipclock_card_destory(clock->second);
-			clock->second = NULL;
-		}
-	}
-	// Toggling seconds always changes size.
-	_flipclock_clock_update_layout(clock);
+	_flipclock_clock_post(clock, FLIPCLOCK_MESSAGE_SHOW_SECOND, NULL,
+			      show_second);
+}
+
+void flipclock_clock_set_show_hud(struct flipclock_clock *clock, bool show_hud)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	_flipclock_clock_post(clock, FLIPCLOCK_MESSAGE_SHOW_HUD, NULL,
+			      show_hud);
 }
 
 void flipclock_clock_set_fullscreen(struct flipclock_clock *clock, bool full)
@@ -239,9 +832,12 @@ void flipclock_clock_set_fullscreen(struct flipclock_clock *clock, bool full)
 	SDL_Rect display_bounds;
 	int clock_x;
 	int clock_y;
+	int clock_w;
+	int clock_h;
 	SDL_GetWindowPosition(clock->window, &clock_x, &clock_y);
-	int clock_center_x = clock_x + clock->w / 2;
-	int clock_center_y = clock_y + clock->h / 2;
+	SDL_GetWindowSize(clock->window, &clock_w, &clock_h);
+	int clock_center_x = clock_x + clock_w / 2;
+	int clock_center_y = clock_y + clock_h / 2;
 	int displays_length = SDL_GetNumVideoDisplays();
 	// If a clock is out of all displays it will be re-placed into the last.
 	for (int i = 0; i < displays_length; ++i) {
@@ -261,9 +857,9 @@ void flipclock_clock_set_fullscreen(struct flipclock_clock *clock, bool full)
 				      display_bounds.y);
 		SDL_SetWindowFullscreen(clock->window,
 					SDL_WINDOW_FULLSCREEN_DESKTOP);
-		SDL_GetWindowSize(clock->window, &clock->w, &clock->h);
+		SDL_GetWindowSize(clock->window, &clock_w, &clock_h);
 		LOG_DEBUG("Set clock `%d` to fullscreen with size `%dx%d`.\n",
-			  clock->i, clock->w, clock->h);
+			  clock->i, clock_w, clock_h);
 	} else {
 		SDL_SetWindowFullscreen(clock->window, 0);
 		/**
@@ -280,56 +876,71 @@ void flipclock_clock_set_fullscreen(struct flipclock_clock *clock, bool full)
 				(display_bounds.w - WINDOW_WIDTH) / 2,
 			display_bounds.y +
 				(display_bounds.h - WINDOW_HEIGHT) / 2);
-		SDL_GetWindowSize(clock->window, &clock->w, &clock->h);
 		LOG_DEBUG("Set clock `%d` to windowed.\n", clock->i);
 	}
 	// Toggling fullscreen always changes size.
-	_flipclock_clock_update_layout(clock);
+	_flipclock_clock_post_resize(clock);
 }
 
-void flipclock_clock_set_hour(struct flipclock_clock *clock, const char hour[],
-			      bool flip)
+void flipclock_clock_set_text(struct flipclock_clock *clock, int card_i,
+			      const char text[], bool flip)
 {
 	// Text can be NULL to clear card.
 	RETURN_IF_FAIL(clock != NULL);
 
-	flipclock_card_set_text(clock->hour, hour);
-	if (flip)
-		flipclock_card_flip(clock->hour);
+	_flipclock_clock_post_text(clock, FLIPCLOCK_MESSAGE_TEXT, card_i, text,
+				   flip);
 }
 
-void flipclock_clock_set_minute(struct flipclock_clock *clock,
-				const char minute[], bool flip)
+void flipclock_clock_set_sub_text(struct flipclock_clock *clock, int card_i,
+				  const char sub_text[])
 {
 	// Text can be NULL to clear card.
 	RETURN_IF_FAIL(clock != NULL);
 
-	flipclock_card_set_text(clock->minute, minute);
-	if (flip)
-		flipclock_card_flip(clock->minute);
+	_flipclock_clock_post_text(clock, FLIPCLOCK_MESSAGE_SUB_TEXT, card_i,
+				   sub_text, false);
 }
 
-void flipclock_clock_set_second(struct flipclock_clock *clock,
-				const char second[], bool flip)
+/**
+ * Text can be NULL if it won't change at the next time boundary, then the
+ * card has nothing to prepare.
+ */
+void flipclock_clock_set_next_text(struct flipclock_clock *clock, int card_i,
+				   const char next_text[])
 {
-	// Text can be NULL to clear card.
 	RETURN_IF_FAIL(clock != NULL);
 
-	if (!clock->app->show_second)
-		return;
+	_flipclock_clock_post_text(clock, FLIPCLOCK_MESSAGE_NEXT_TEXT, card_i,
+				   next_text, false);
+}
+
+/**
+ * Main thread gives the time of toggling, so all clocks start and pause at the
+ * same value.
+ */
+void flipclock_clock_toggle_counter(struct flipclock_clock *clock, Uint64 now)
+{
+	RETURN_IF_FAIL(clock != NULL);
 
-	flipclock_card_set_text(clock->second, second);
-	if (flip)
-		flipclock_card_flip(clock->second);
+	struct flipclock_message message;
+	message.type = FLIPCLOCK_MESSAGE_TOGGLE_COUNTER;
+	message.card_i = -1;
+	message.has_text = false;
+	message.text[0] = '\0';
+	message.flag = false;
+	message.w = 0;
+	message.h = 0;
+	message.tick = now;
+	flipclock_queue_push(clock->queue, &message);
 }
 
-void flipclock_clock_set_ampm(struct flipclock_clock *clock, const char ampm[])
+void flipclock_clock_reset_counter(struct flipclock_clock *clock)
 {
-	// Text can be NULL to clear card.
 	RETURN_IF_FAIL(clock != NULL);
 
-	flipclock_card_set_sub_text(clock->hour, ampm);
-	// Set ampm should never flip a card.
+	_flipclock_clock_post(clock, FLIPCLOCK_MESSAGE_RESET_COUNTER, NULL,
+			      false);
 }
 
 void flipclock_clock_handle_window_event(struct flipclock_clock *clock,
@@ -341,27 +952,25 @@ void flipclock_clock_handle_window_event(struct flipclock_clock *clock,
 	int clock_i = clock->i;
 	switch (event.window.event) {
 	case SDL_WINDOWEVENT_SIZE_CHANGED:
-		/**
-		 * Only re-render when size changed.
-		 * Windows may send event when size
-		 * not changed, and cause strange bugs.
-		 */
-		if (event.window.data1 != clock->w ||
-		    event.window.data2 != clock->h) {
-			clock->w = event.window.data1;
-			clock->h = event.window.data2;
-			LOG_DEBUG("New window size for "
-				  "clock `%d` is `%dx%d`.\n",
-				  clock->i, clock->w, clock->h);
-			_flipclock_clock_update_layout(clock);
-		}
+		_flipclock_clock_post_resize(clock);
+		break;
+	/**
+	 * Window system asks us to draw again, we don't have damage region,
+	 * so just present the whole window.
+	 */
+	case SDL_WINDOWEVENT_SHOWN:
+	case SDL_WINDOWEVENT_EXPOSED:
+		_flipclock_clock_post(clock, FLIPCLOCK_MESSAGE_EXPOSE, NULL,
+				      false);
 		break;
 	case SDL_WINDOWEVENT_MINIMIZED:
-		clock->waiting = true;
+		_flipclock_clock_post(clock, FLIPCLOCK_MESSAGE_WAIT, NULL,
+				      true);
 		break;
 	// `RESTORED` is emitted after `MINIMIZED`.
 	case SDL_WINDOWEVENT_RESTORED:
-		clock->waiting = false;
+		_flipclock_clock_post(clock, FLIPCLOCK_MESSAGE_WAIT, NULL,
+				      false);
 		/**
 		 * Sometimes when a window is restored, its texture get lost.
 		 * Typically happens when we have two fullscreen clocks in
@@ -387,33 +996,63 @@ void flipclock_clock_handle_window_event(struct flipclock_clock *clock,
 	}
 }
 
-void flipclock_clock_animate(struct flipclock_clock *clock)
+/**
+ * Only clocks rendered in main thread need main loop to wake up for frames,
+ * threaded clocks wait for their own frames.
+ */
+bool flipclock_clock_is_animating(const struct flipclock_clock *clock)
 {
-	RETURN_IF_FAIL(clock != NULL);
+	RETURN_VAL_IF_FAIL(clock != NULL, false);
 
-	const struct flipclock *app = clock->app;
-	SDL_SetRenderDrawColor(clock->renderer, app->background_color.r,
-			       app->background_color.g, app->background_color.b,
-			       app->background_color.a);
-	SDL_RenderClear(clock->renderer);
+	if (clock->thread != NULL)
+		return false;
+	return !flipclock_queue_is_empty(clock->queue) || clock->resizing ||
+	       _flipclock_clock_needs_frame(clock);
+}
 
-	flipclock_card_animate(clock->hour);
-	flipclock_card_animate(clock->minute);
-	if (app->show_second)
-		flipclock_card_animate(clock->second);
+/**
+ * Milliseconds main thread may wait before rendering the next frame of this
+ * clock, -1 if it has nothing to draw.
+ */
+int flipclock_clock_get_timeout(const struct flipclock_clock *clock)
+{
+	RETURN_VAL_IF_FAIL(clock != NULL, -1);
 
-	SDL_RenderPresent(clock->renderer);
+	if (!flipclock_clock_is_animating(clock))
+		return -1;
+	return _flipclock_clock_get_frame_timeout(clock);
+}
+
+// Render a frame for clocks in main thread.
+void flipclock_clock_animate(struct flipclock_clock *clock)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	if (clock->thread != NULL)
+		return;
+	_flipclock_clock_dispatch(clock);
+	_flipclock_clock_render(clock);
+	_flipclock_clock_prepare(clock);
 }
 
 void flipclock_clock_destroy(struct flipclock_clock *clock)
 {
 	RETURN_IF_FAIL(clock != NULL);
 
-	flipclock_card_destory(clock->hour);
-	flipclock_card_destory(clock->minute);
-	if (clock->second != NULL)
-		flipclock_card_destory(clock->second);
-	SDL_DestroyRenderer(clock->renderer);
+	if (clock->thread != NULL) {
+		// Render thread destroys its cards and renderer before exit.
+		_flipclock_clock_post(clock, FLIPCLOCK_MESSAGE_QUIT, NULL,
+				      false);
+		SDL_WaitThread(clock->thread, NULL);
+	} else {
+		_flipclock_clock_destroy_cards(clock);
+		_flipclock_clock_destroy_renderer(clock);
+	}
+	// Render thread is stopped, so it's safe to read stats now.
+	if (clock->app->stats_file != NULL)
+		flipclock_stats_dump(&clock->stats, clock->i,
+				     clock->app->stats_file);
+	flipclock_queue_destroy(clock->queue);
 	SDL_DestroyWindow(clock->window);
 	free(clock);
 }
@@ -2,20 +2,76 @@
 #define __CLOCK_H__
 
 #include <stdbool.h>
+#include <time.h>
 
 #include <SDL.h>
+#include <SDL_ttf.h>
+
+#include "counter.h"
+#include "layout.h"
+#include "stats.h"
+
+/**
+ * Indices of cards, card of second is only created when showing second. See
+ * `counter.h` for cards in counter mode.
+ */
+enum flipclock_clock_card {
+	FLIPCLOCK_CARD_HOUR,
+	FLIPCLOCK_CARD_MINUTE,
+	FLIPCLOCK_CARD_SECOND
+};
 
 struct flipclock_clock {
 	struct flipclock *app;
 	SDL_Window *window;
 	SDL_Renderer *renderer;
-	struct flipclock_card *hour;
-	struct flipclock_card *minute;
-	struct flipclock_card *second;
+	// Cards of the same size share atlases from it.
+	struct flipclock_atlases *atlases;
+	// Cards after `cards_length` are NULL.
+	struct flipclock_card *cards[MAX_CARDS];
+	// NULL if clock is rendered in main thread.
+	SDL_Thread *thread;
+	struct flipclock_queue *queue;
 	int i;
+	// Timezone and time shown by this clock, only used by main thread.
+	struct flipclock_zone *zone;
+	struct tm now;
+	/**
+	 * Fields below are owned by the thread that renders the clock, main
+	 * thread should send messages to change them.
+	 */
 	int w;
 	int h;
+	int cards_length;
+	// Rects of cards, only calculated again when size or cards changed.
+	struct flipclock_layout layout;
+	bool show_second;
+	// Only used in counter mode, values of cards are calculated from it.
+	struct flipclock_counter counter;
 	bool waiting;
+	// Window content is lost or changed and should be presented again.
+	bool dirty;
+	// Resize messages are coalesced and applied once per frame.
+	bool layout_pending;
+	// Faces are scaled until window size is settled.
+	bool resizing;
+	long long resize_tick;
+	bool running;
+	long long frame_tick;
+	/**
+	 * Background and idle cards are composited into this layer, so a frame
+	 * only copies it and draws animating cards on top of it.
+	 */
+	SDL_Texture *layer;
+	// Bit `i` is set if card `i` is drawn in layer.
+	unsigned int layer_cards;
+	bool layer_valid;
+	struct flipclock_stats stats;
+	// Overlay showing frame timings.
+	bool show_hud;
+	TTF_Font *hud_font;
+	SDL_Texture *hud;
+	long long hud_tick;
 };
 
 struct flipclock_clock *flipclock_clock_create(struct flipclock *app, int i);
@@ -24,16 +80,20 @@ struct flipclock_clock *flipclock_clock_create_preview(struct flipclock *app);
 #endif
 void flipclock_clock_set_show_second(struct flipclock_clock *clock,
 				     bool show_second);
+void flipclock_clock_set_show_hud(struct flipclock_clock *clock, bool show_hud);
 void flipclock_clock_set_fullscreen(struct flipclock_clock *clock, bool full);
-void flipclock_clock_set_hour(struct flipclock_clock *clock, const char hour[],
-			      bool flip);
-void flipclock_clock_set_minute(struct flipclock_clock *clock,
-				const char minute[], bool flip);
-void flipclock_clock_set_second(struct flipclock_clock *clock,
-				const char second[], bool flip);
-void flipclock_clock_set_ampm(struct flipclock_clock *clock, const char ampm[]);
+void flipclock_clock_set_text(struct flipclock_clock *clock, int card_i,
+			      const char text[], bool flip);
+void flipclock_clock_set_sub_text(struct flipclock_clock *clock, int card_i,
+				  const char sub_text[]);
+void flipclock_clock_set_next_text(struct flipclock_clock *clock, int card_i,
+				   const char next_text[]);
+void flipclock_clock_toggle_counter(struct flipclock_clock *clock, Uint64 now);
+void flipclock_clock_reset_counter(struct flipclock_clock *clock);
 void flipclock_clock_handle_window_event(struct flipclock_clock *clock,
 					 SDL_Event event);
+bool flipclock_clock_is_animating(const struct flipclock_clock *clock);
+int flipclock_clock_get_timeout(const struct flipclock_clock *clock);
 void flipclock_clock_animate(struct flipclock_clock *clock);
 void flipclock_clock_destroy(struct flipclock_clock *clock);
 
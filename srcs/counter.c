@@ -0,0 +1,95 @@
+#include <stdio.h>
+
+#include "flipclock.h"
+#include "counter.h"
+
+void flipclock_counter_init(struct flipclock_counter *counter,
+			    long long countdown)
+{
+	RETURN_IF_FAIL(counter != NULL);
+
+	counter->countdown = countdown;
+	counter->running = false;
+	counter->start = 0;
+	counter->elapsed = 0;
+}
+
+// Centiseconds counted until now, it may be over countdown.
+static long long
+_flipclock_counter_get_elapsed(const struct flipclock_counter *counter,
+			       Uint64 now)
+{
+	RETURN_VAL_IF_FAIL(counter != NULL, 0);
+
+	Uint64 ticks = counter->elapsed;
+	if (counter->running && now > counter->start)
+		ticks += now - counter->start;
+	return ticks * 100 / SDL_GetPerformanceFrequency();
+}
+
+/**
+ * Pause a running counter, or start a paused one. A finished countdown starts
+ * again from the beginning.
+ */
+void flipclock_counter_toggle(struct flipclock_counter *counter, Uint64 now)
+{
+	RETURN_IF_FAIL(counter != NULL);
+
+	// Countdown might be finished before this, stop it at the end first.
+	flipclock_counter_update(counter, now);
+	if (counter->running) {
+		if (now > counter->start)
+			counter->elapsed += now - counter->start;
+		counter->running = false;
+		return;
+	}
+	if (counter->countdown != 0 &&
+	    _flipclock_counter_get_elapsed(counter, now) >= counter->countdown)
+		flipclock_counter_reset(counter);
+	counter->start = now;
+	counter->running = true;
+}
+
+void flipclock_counter_reset(struct flipclock_counter *counter)
+{
+	RETURN_IF_FAIL(counter != NULL);
+
+	counter->running = false;
+	counter->start = 0;
+	counter->elapsed = 0;
+}
+
+// Returns centiseconds to show, a countdown stops itself at 0.
+long long flipclock_counter_update(struct flipclock_counter *counter,
+				   Uint64 now)
+{
+	RETURN_VAL_IF_FAIL(counter != NULL, 0);
+
+	const long long elapsed = _flipclock_counter_get_elapsed(counter, now);
+	if (counter->countdown == 0)
+		return elapsed;
+	if (elapsed < counter->countdown)
+		return counter->countdown - elapsed;
+	if (counter->running) {
+		counter->elapsed += now - counter->start;
+		counter->running = false;
+	}
+	return 0;
+}
+
+/**
+ * Minutes are not wrapped into hours, so they may be more than 2 digits, but
+ * a stopwatch running for weeks only keeps 4 of them.
+ */
+void flipclock_counter_format(long long value,
+			      char texts[COUNTER_CARDS][MAX_TEXT_LENGTH])
+{
+	RETURN_IF_FAIL(texts != NULL);
+
+	snprintf(texts[FLIPCLOCK_COUNTER_MINUTE], MAX_TEXT_LENGTH, "%02lld",
+		 value / 6000 % 10000);
+	snprintf(texts[FLIPCLOCK_COUNTER_SECOND], MAX_TEXT_LENGTH, "%02lld",
+		 value / 100 % 60);
+	snprintf(texts[FLIPCLOCK_COUNTER_CENTISECOND], MAX_TEXT_LENGTH,
+		 "%02lld", value % 100);
+}
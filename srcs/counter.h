@@ -0,0 +1,47 @@
+#ifndef __COUNTER_H__
+#define __COUNTER_H__
+
+#include <stdbool.h>
+
+#include <SDL.h>
+
+#include "card.h"
+
+// Longest countdown, in centiseconds.
+#define MAX_COUNTDOWN (100LL * 3600 * 100)
+
+// Indices of cards in counter mode.
+enum flipclock_counter_card {
+	FLIPCLOCK_COUNTER_MINUTE,
+	FLIPCLOCK_COUNTER_SECOND,
+	FLIPCLOCK_COUNTER_CENTISECOND
+};
+
+#define COUNTER_CARDS (FLIPCLOCK_COUNTER_CENTISECOND + 1)
+
+/**
+ * A stopwatch or a countdown, it is driven by performance counter, so it is
+ * monotonic and won't jump with realtime. Main thread only sends the time of
+ * toggling it, and the thread that renders the clock calculates value
+ * for every frame, so all clocks show the same value.
+ */
+struct flipclock_counter {
+	// Centiseconds to count down from, 0 for a stopwatch.
+	long long countdown;
+	bool running;
+	// Performance counter when it starts running last time.
+	Uint64 start;
+	// Performance counter ticks counted before last start.
+	Uint64 elapsed;
+};
+
+void flipclock_counter_init(struct flipclock_counter *counter,
+			    long long countdown);
+void flipclock_counter_toggle(struct flipclock_counter *counter, Uint64 now);
+void flipclock_counter_reset(struct flipclock_counter *counter);
+long long flipclock_counter_update(struct flipclock_counter *counter,
+				   Uint64 now);
+void flipclock_counter_format(long long value,
+			      char texts[COUNTER_CARDS][MAX_TEXT_LENGTH]);
+
+#endif
@@ -10,13 +10,20 @@
 #include "flipclock.h"
 #include "clock.h"
 #include "card.h"
+#include "counter.h"
+#include "timer.h"
+#include "font.h"
+#include "worker.h"
+#include "sdf.h"
+#include "cache.h"
+#include "router.h"
+#include "zone.h"
 
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
-#define FPS 60
-#define MAX_PROGRESS 300
-#define HALF_PROGRESS (MAX_PROGRESS / 2)
 #define DOUBLE_TAP_INTERVAL_MS 300
+// Events handled before drawing a frame, others are left for next frame.
+#define MAX_EVENTS 64
 
 #if defined(_WIN32)
 static void _flipclock_get_program_dir_win32(char program_dir[])
@@ -45,6 +52,22 @@ static void _flipclock_get_program_dir_win32(char program_dir[])
 }
 #endif
 
+static void _flipclock_load_resources(void *data)
+{
+	struct flipclock *app = data;
+
+	// Font path is decided after loading configuration and arguments.
+	app->fonts = flipclock_fonts_create(app->font_path);
+	// Only this uses FreeType, resizing just samples it again.
+	if (app->sdf_glyphs)
+		app->sdf = flipclock_sdf_create(app->fonts);
+	// Distance field is already fast, so cache is only used for fonts.
+	else if (app->glyph_cache)
+		app->cache = flipclock_cache_create(app->fonts->data,
+						    app->fonts->data_size,
+						    app->text_scale);
+}
+
 struct flipclock *flipclock_create(void)
 {
 	struct flipclock *app = malloc(sizeof(*app));
@@ -53,8 +76,10 @@ struct flipclock *flipclock_create(void)
 		exit(EXIT_FAILURE);
 	}
 	app->clocks = NULL;
+	app->timer = NULL;
 	// Should create 1 clock in windowed mode.
 	app->clocks_length = 1;
+	app->router = NULL;
 	app->last_touch_time = 0;
 	app->last_touch_finger = 0;
 	app->running = true;
@@ -73,10 +98,34 @@ struct flipclock *flipclock_create(void)
 	app->ampm = false;
 	app->full = true;
 	app->show_second = false;
+	app->counter = false;
+	app->countdown = 0;
 	app->font_path[0] = '\0';
 	app->conf_path[0] = '\0';
+	app->stats_path[0] = '\0';
+	app->stats_file = NULL;
+	app->trace_path[0] = '\0';
+	app->show_hud = false;
 	app->text_scale = 1.0;
 	app->card_scale = 1.0;
+	app->fonts = NULL;
+	app->workers = NULL;
+	app->worker_threads = -1;
+	app->sdf = NULL;
+	app->cache = NULL;
+	flipclock_job_init(&app->resources_job, _flipclock_load_resources,
+			   app);
+	app->resources_loading = false;
+	app->cpu_compose = false;
+	app->sdf_glyphs = false;
+	app->glyph_cache = true;
+	// Time to first frame is counted from here, before loading conf.
+	app->start_counter = SDL_GetPerformanceCounter();
+	/**
+	 * SDL does not support rendering out of main thread, so render threads
+	 * are experimental and must be enabled by users.
+	 */
+	app->render_threads = false;
 #if defined(_WIN32)
 	app->preview = false;
 	app->screensaver = false;
@@ -97,8 +146,10 @@ struct flipclock *flipclock_create(void)
 	app->font_path[MAX_BUFFER_LENGTH - 1] = '\0';
 	if (strlen(app->font_path) == MAX_BUFFER_LENGTH - 1)
 		LOG_ERROR("`font_path` too long, may fail to load.\n");
-	time_t raw_time = time(NULL);
-	app->now = *localtime(&raw_time);
+	app->zone = flipclock_zone_create(NULL);
+	app->zones = NULL;
+	app->zones_length = 0;
+	app->now_time = flipclock_zone_get_now(app->zone);
 	return app;
 }
 
@@ -176,6 +227,111 @@ static int _flipclock_parse_key_value(char line[], char **key, char **value)
 	return 0;
 }
 
+static void _flipclock_destroy_zones(struct flipclock *app)
+{
+	RETURN_IF_FAIL(app != NULL);
+
+	for (int i = 0; i < app->zones_length; ++i) {
+		if (app->zones[i] == NULL)
+			continue;
+		flipclock_zone_destroy(app->zones[i]);
+	}
+	free(app->zones);
+	app->zones = NULL;
+	app->zones_length = 0;
+}
+
+/**
+ * `timezones` is a comma separated list of `TZ` values, clock `i` shows the
+ * zone `i`, and empty or `local` shows local timezone.
+ */
+static void _flipclock_parse_timezones(struct flipclock *app,
+				       const char value[])
+{
+	RETURN_IF_FAIL(app != NULL);
+	RETURN_IF_FAIL(value != NULL);
+
+	_flipclock_destroy_zones(app);
+	int length = 1;
+	for (int i = 0; value[i] != '\0'; ++i) {
+		if (value[i] == ',')
+			++length;
+	}
+	// NOLINTNEXTLINE(bugprone-sizeof-expression)
+	app->zones = malloc(sizeof(*app->zones) * length);
+	if (app->zones == NULL) {
+		LOG_ERROR("Failed to create zones!\n");
+		exit(EXIT_FAILURE);
+	}
+	app->zones_length = length;
+	const char *start = value;
+	for (int i = 0; i < length; ++i) {
+		const char *end = strchr(start, ',');
+		if (end == NULL)
+			end = start + strlen(start);
+		const char *next = end + 1;
+		while (start < end && isspace(start[0]))
+			++start;
+		while (end > start && isspace(end[-1]))
+			--end;
+		char name[MAX_BUFFER_LENGTH];
+		snprintf(name, MAX_BUFFER_LENGTH, "%.*s", (int)(end - start),
+			 start);
+		if (name[0] == '\0' || !strcmp(name, "local")) {
+			app->zones[i] = NULL;
+		} else {
+			LOG_DEBUG("Clock `%d` uses timezone `%s`.\n", i, name);
+			app->zones[i] = flipclock_zone_create(name);
+		}
+		start = next;
+	}
+}
+
+/**
+ * `counter` is `stopwatch`, or a duration like `25:00` or `1:30:00` to count
+ * down from, and `false` shows time.
+ */
+static void _flipclock_parse_counter(struct flipclock *app, const char value[])
+{
+	RETURN_IF_FAIL(app != NULL);
+	RETURN_IF_FAIL(value != NULL);
+
+	if (!strcmp(value, "false")) {
+		app->counter = false;
+		return;
+	}
+	if (!strcmp(value, "stopwatch")) {
+		app->counter = true;
+		app->countdown = 0;
+		return;
+	}
+	long long seconds = 0;
+	const char *start = value;
+	// Hours, minutes and seconds at most.
+	for (int i = 0; i < 3; ++i) {
+		char *end = NULL;
+		const long part = strtol(start, &end, 10);
+		if (end == start || part < 0 || part * 100 > MAX_COUNTDOWN)
+			break;
+		seconds = seconds * 60 + part;
+		if (seconds * 100 > MAX_COUNTDOWN)
+			break;
+		if (end[0] == '\0') {
+			if (seconds == 0)
+				break;
+			LOG_DEBUG("Counting down from `%lld` seconds.\n",
+				  seconds);
+			app->counter = true;
+			app->countdown = seconds * 100;
+			return;
+		}
+		if (end[0] != ':')
+			break;
+		start = end + 1;
+	}
+	LOG_ERROR("Failed to parse `counter`!\n");
+}
+
 static int _flipclock_parse_color(const char rgba[], SDL_Color *color)
 {
 	RETURN_VAL_IF_FAIL(rgba != NULL, -5);
@@ -297,6 +453,38 @@ static void _flipclock_apply_key_value(struct flipclock *app, const char key[],
 	} else if (!strcmp(key, "show_second")) {
 		if (!strcmp(value, "true"))
 			app->show_second = true;
+	} else if (!strcmp(key, "render_threads")) {
+		if (!strcmp(value, "true"))
+			app->render_threads = true;
+		else if (!strcmp(value, "false"))
+			app->render_threads = false;
+	} else if (!strcmp(key, "cpu_compose")) {
+		if (!strcmp(value, "true"))
+			app->cpu_compose = true;
+		else if (!strcmp(value, "false"))
+			app->cpu_compose = false;
+	} else if (!strcmp(key, "sdf_glyphs")) {
+		if (!strcmp(value, "true"))
+			app->sdf_glyphs = true;
+		else if (!strcmp(value, "false"))
+			app->sdf_glyphs = false;
+	} else if (!strcmp(key, "glyph_cache")) {
+		if (!strcmp(value, "true"))
+			app->glyph_cache = true;
+		else if (!strcmp(value, "false"))
+			app->glyph_cache = false;
+	} else if (!strcmp(key, "timezones")) {
+		_flipclock_parse_timezones(app, value);
+	} else if (!strcmp(key, "counter")) {
+		_flipclock_parse_counter(app, value);
+	} else if (!strcmp(key, "worker_threads")) {
+		app->worker_threads = strtol(value, NULL, 10);
+	} else if (!strcmp(key, "stats_file")) {
+		strncpy(app->stats_path, value, MAX_BUFFER_LENGTH);
+		app->stats_path[MAX_BUFFER_LENGTH - 1] = '\0';
+	} else if (!strcmp(key, "trace_file")) {
+		strncpy(app->trace_path, value, MAX_BUFFER_LENGTH);
+		app->trace_path[MAX_BUFFER_LENGTH - 1] = '\0';
 	} else if (!strcmp(key, "font")) {
 		strncpy(app->font_path, value, MAX_BUFFER_LENGTH);
 		app->font_path[MAX_BUFFER_LENGTH - 1] = '\0';
@@ -393,6 +581,94 @@ void flipclock_load_conf(struct flipclock *app)
 	fclose(conf);
 }
 
+static void _flipclock_format_hour(const struct flipclock *app,
+				   const struct tm *tm, char text[3])
+{
+	RETURN_IF_FAIL(app != NULL);
+	RETURN_IF_FAIL(tm != NULL);
+	RETURN_IF_FAIL(text != NULL);
+
+	strftime(text, 3, app->ampm ? "%I" : "%H", tm);
+	// Trim zero when using 12-hour clock.
+	if (app->ampm && text[0] == '0') {
+		text[0] = text[1];
+		text[1] = text[2];
+	}
+}
+
+static void _flipclock_send_ampm(const struct flipclock *app,
+				 struct flipclock_clock *clock)
+{
+	RETURN_IF_FAIL(app != NULL);
+	RETURN_IF_FAIL(clock != NULL);
+
+	if (app->ampm) {
+		char text[3];
+		snprintf(text, sizeof(text), "%cM",
+			 clock->now.tm_hour / 12 ? 'P' : 'A');
+		flipclock_clock_set_sub_text(clock, FLIPCLOCK_CARD_HOUR, text);
+	} else {
+		flipclock_clock_set_sub_text(clock, FLIPCLOCK_CARD_HOUR, NULL);
+	}
+}
+
+static void _flipclock_send_hour(const struct flipclock *app,
+				 struct flipclock_clock *clock, bool flip)
+{
+	RETURN_IF_FAIL(app != NULL);
+	RETURN_IF_FAIL(clock != NULL);
+
+	char text[3];
+	_flipclock_format_hour(app, &clock->now, text);
+	flipclock_clock_set_text(clock, FLIPCLOCK_CARD_HOUR, text, flip);
+}
+
+static void _flipclock_send_minute(struct flipclock_clock *clock, bool flip)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	char text[3];
+	strftime(text, sizeof(text), "%M", &clock->now);
+	flipclock_clock_set_text(clock, FLIPCLOCK_CARD_MINUTE, text, flip);
+}
+
+static void _flipclock_send_second(struct flipclock_clock *clock, bool flip)
+{
+	RETURN_IF_FAIL(clock != NULL);
+
+	char text[3];
+	strftime(text, sizeof(text), "%S", &clock->now);
+	flipclock_clock_set_text(clock, FLIPCLOCK_CARD_SECOND, text, flip);
+}
+
+/**
+ * Send current time to a new clock, so it presents its first frame once its
+ * glyphs are ready, instead of waiting for other clocks being created.
+ */
+static void _flipclock_start_clock(struct flipclock *app,
+				   struct flipclock_clock *clock)
+{
+	RETURN_IF_FAIL(app != NULL);
+	RETURN_IF_FAIL(clock != NULL);
+
+	// Clocks without their own timezones show local time.
+	if (clock->i < app->zones_length && app->zones[clock->i] != NULL)
+		clock->zone = app->zones[clock->i];
+	else
+		clock->zone = app->zone;
+	// Creating windows and loading fonts takes time, don't show old time.
+	app->now_time = flipclock_zone_get_now(app->zone);
+	flipclock_zone_get_time(clock->zone, app->now_time, &clock->now);
+	// Counter cards are set by clocks themselves.
+	if (app->counter)
+		return;
+	_flipclock_send_ampm(app, clock);
+	_flipclock_send_hour(app, clock, false);
+	_flipclock_send_minute(clock, false);
+	if (app->show_second)
+		_flipclock_send_second(clock, false);
+}
+
 static void _flipclock_create_clocks(struct flipclock *app)
 {
 	RETURN_IF_FAIL(app != NULL);
@@ -405,6 +681,9 @@ static void _flipclock_create_clocks(struct flipclock *app)
 		 */
 		app->clocks_length = SDL_GetNumVideoDisplays();
 		SDL_ShowCursor(SDL_DISABLE);
+	} else if (app->zones_length > 1) {
+		// Create window for each timezone if not fullscreen.
+		app->clocks_length = app->zones_length;
 	}
 	// I know what I am doing, silly tidy tools.
 	// NOLINTNEXTLINE(bugprone-sizeof-expression)
@@ -413,8 +692,18 @@ static void _flipclock_create_clocks(struct flipclock *app)
 		LOG_ERROR("Failed to create clocks!\n");
 		exit(EXIT_FAILURE);
 	}
-	for (int i = 0; i < app->clocks_length; ++i)
-		app->clocks[i] = flipclock_clock_create(app, i);
+	/**
+	 * Clocks rendered in their own threads present their first frames
+	 * while we are creating next windows, others are presented together
+	 * by main loop, while their glyphs are rasterized together.
+	 */
+	for (int i = 0; i < app->clocks_length; ++i) {
+		struct flipclock_clock *clock = flipclock_clock_create(app, i);
+		app->clocks[i] = clock;
+		const Uint32 window_id = SDL_GetWindowID(clock->window);
+		flipclock_router_add(app->router, window_id, i);
+		_flipclock_start_clock(app, clock);
+	}
 }
 
 #if defined(_WIN32)
@@ -489,6 +778,9 @@ static void _flipclock_create_preview_win32(struct flipclock *app)
 	}
 	// Create window from native window when in preview.
 	app->clocks[0] = flipclock_clock_create_preview(app);
+	const Uint32 window_id = SDL_GetWindowID(app->clocks[0]->window);
+	flipclock_router_add(app->router, window_id, 0);
+	_flipclock_start_clock(app, app->clocks[0]);
 }
 
 static void _flipclock_create_clocks_win32(struct flipclock *app)
@@ -508,6 +800,22 @@ void flipclock_create_clocks(struct flipclock *app)
 {
 	RETURN_IF_FAIL(app != NULL);
 
+	if (app->worker_threads != 0)
+		app->workers = flipclock_workers_create(app->worker_threads);
+	/**
+	 * Loading font file and creating distance field are slow, do them in
+	 * workers while creating windows and renderers.
+	 */
+	app->resources_loading = true;
+	flipclock_workers_push(app->workers, &app->resources_job);
+	app->router = flipclock_router_create();
+	if (app->stats_path[0] != '\0') {
+		app->stats_file = fopen(app->stats_path, "w");
+		if (app->stats_file == NULL)
+			LOG_ERROR("Failed to open `%s`, stats are disabled!\n",
+				  app->stats_path);
+	}
+
 #if defined(_WIN32)
 	_flipclock_create_clocks_win32(app);
 #else
@@ -517,16 +825,17 @@ void flipclock_create_clocks(struct flipclock *app)
 #endif
 }
 
-static void _flipclock_set_show_second(struct flipclock *app, bool show_second)
+/**
+ * Clocks call this before creating cards, because cards use fonts. It returns
+ * immediately once resources are loaded, or if they are loaded by caller
+ * instead, like benchmark.
+ */
+void flipclock_wait_resources(struct flipclock *app)
 {
 	RETURN_IF_FAIL(app != NULL);
 
-	app->show_second = show_second;
-	for (int i = 0; i < app->clocks_length; ++i) {
-		if (app->clocks[i] == NULL)
-			continue;
-		flipclock_clock_set_show_second(app->clocks[i], show_second);
-	}
+	if (app->resources_loading)
+		flipclock_workers_wait(app->workers, &app->resources_job);
 }
 
 static void _flipclock_set_fullscreen(struct flipclock *app, bool full)
@@ -545,6 +854,18 @@ static void _flipclock_set_fullscreen(struct flipclock *app, bool full)
 	}
 }
 
+static void _flipclock_set_show_hud(struct flipclock *app, bool show_hud)
+{
+	RETURN_IF_FAIL(app != NULL);
+
+	app->show_hud = show_hud;
+	for (int i = 0; i < app->clocks_length; ++i) {
+		if (app->clocks[i] == NULL)
+			continue;
+		flipclock_clock_set_show_hud(app->clocks[i], show_hud);
+	}
+}
+
 /**
  * If you changed `ampm`, you must call `_flipclock_set_hour()` after it,
  * because hour number will change in differet types.
@@ -554,21 +875,54 @@ static void _flipclock_set_ampm(struct flipclock *app, bool ampm)
 	RETURN_IF_FAIL(app != NULL);
 
 	app->ampm = ampm;
-	if (app->ampm) {
-		for (int i = 0; i < app->clocks_length; ++i) {
-			if (app->clocks[i] == NULL)
-				continue;
-			char text[3];
-			snprintf(text, sizeof(text), "%cM",
-				 app->now.tm_hour / 12 ? 'P' : 'A');
-			flipclock_clock_set_ampm(app->clocks[i], text);
-		}
-	} else {
-		for (int i = 0; i < app->clocks_length; ++i) {
-			if (app->clocks[i] == NULL)
-				continue;
-			flipclock_clock_set_ampm(app->clocks[i], NULL);
-		}
+	if (app->counter)
+		return;
+	for (int i = 0; i < app->clocks_length; ++i) {
+		if (app->clocks[i] == NULL)
+			continue;
+		_flipclock_send_ampm(app, app->clocks[i]);
+	}
+}
+
+/**
+ * Send texts of the next time boundary, so clocks can draw their faces before
+ * it comes. Only changed texts are sent, others won't be prepared.
+ */
+static void _flipclock_set_next(struct flipclock *app)
+{
+	RETURN_IF_FAIL(app != NULL);
+
+	if (app->counter)
+		return;
+	/**
+	 * Next timer tick, it is aligned to minute if we don't show second.
+	 * Zone offsets are whole minutes, so it is the same for all clocks.
+	 */
+	const int step = app->show_second ? 1 : 60 - app->now_time % 60;
+	const time_t raw_time = app->now_time + step;
+	for (int i = 0; i < app->clocks_length; ++i) {
+		struct flipclock_clock *clock = app->clocks[i];
+		if (clock == NULL)
+			continue;
+		struct tm next;
+		flipclock_zone_get_time(clock->zone, raw_time, &next);
+		char hour[3];
+		char minute[3];
+		char second[3];
+		char now_hour[3];
+		_flipclock_format_hour(app, &next, hour);
+		_flipclock_format_hour(app, &clock->now, now_hour);
+		strftime(minute, sizeof(minute), "%M", &next);
+		strftime(second, sizeof(second), "%S", &next);
+		flipclock_clock_set_next_text(clock, FLIPCLOCK_CARD_HOUR,
+					      strcmp(hour, now_hour) ? hour :
+								       NULL);
+		flipclock_clock_set_next_text(
+			clock, FLIPCLOCK_CARD_MINUTE,
+			next.tm_min != clock->now.tm_min ? minute : NULL);
+		flipclock_clock_set_next_text(clock, FLIPCLOCK_CARD_SECOND,
+					      app->show_second ? second :
+								 NULL);
 	}
 }
 
@@ -576,82 +930,171 @@ static void _flipclock_set_hour(struct flipclock *app, bool flip)
 {
 	RETURN_IF_FAIL(app != NULL);
 
+	if (app->counter)
+		return;
 	for (int i = 0; i < app->clocks_length; ++i) {
 		if (app->clocks[i] == NULL)
 			continue;
-		char text[3];
-		strftime(text, sizeof(text), app->ampm ? "%I" : "%H",
-			 &app->now);
-		// Trim zero when using 12-hour clock.
-		if (app->ampm && text[0] == '0') {
-			text[0] = text[1];
-			text[1] = text[2];
+		_flipclock_send_hour(app, app->clocks[i], flip);
+	}
+	// Hour might be in another type now.
+	_flipclock_set_next(app);
+}
+
+static void _flipclock_set_second(struct flipclock *app, bool flip)
+{
+	RETURN_IF_FAIL(app != NULL);
+
+	if (app->counter)
+		return;
+	for (int i = 0; i < app->clocks_length; ++i) {
+		if (app->clocks[i] == NULL)
+			continue;
+		_flipclock_send_second(app->clocks[i], flip);
+	}
+}
+
+/**
+ * Only update cards whose text changed, so this can be called on every timer
+ * tick. Every clock converts the same time with its cached zone offset, and
+ * clocks in zones with different hours only flip their own cards.
+ */
+static void _flipclock_update_time(struct flipclock *app, time_t raw_time)
+{
+	RETURN_IF_FAIL(app != NULL);
+
+	app->now_time = raw_time;
+	if (app->counter)
+		return;
+	for (int i = 0; i < app->clocks_length; ++i) {
+		struct flipclock_clock *clock = app->clocks[i];
+		if (clock == NULL)
+			continue;
+		const struct tm past = clock->now;
+		flipclock_zone_get_time(clock->zone, raw_time, &clock->now);
+		if (clock->now.tm_hour != past.tm_hour) {
+			_flipclock_send_ampm(app, clock);
+			_flipclock_send_hour(app, clock, true);
 		}
-		flipclock_clock_set_hour(app->clocks[i], text, flip);
+		if (clock->now.tm_min != past.tm_min)
+			_flipclock_send_minute(clock, true);
+		if (app->show_second && clock->now.tm_sec != past.tm_sec)
+			_flipclock_send_second(clock, true);
 	}
+	_flipclock_set_next(app);
 }
 
-static void _flipclock_set_minute(struct flipclock *app, bool flip)
+static void _flipclock_set_show_second(struct flipclock *app, bool show_second)
 {
 	RETURN_IF_FAIL(app != NULL);
 
+	app->show_second = show_second;
 	for (int i = 0; i < app->clocks_length; ++i) {
 		if (app->clocks[i] == NULL)
 			continue;
-		char text[3];
-		strftime(text, sizeof(text), "%M", &app->now);
-		flipclock_clock_set_minute(app->clocks[i], text, flip);
+		flipclock_clock_set_show_second(app->clocks[i], show_second);
+	}
+	if (app->timer != NULL) {
+		flipclock_timer_set_interval(app->timer, show_second ? 1 : 60);
+		/**
+		 * Time is only updated every minute if we don't show second,
+		 * so it is outdated now.
+		 */
+		_flipclock_update_time(app,
+				       flipclock_zone_get_now(app->zone));
 	}
 }
 
-static void _flipclock_set_second(struct flipclock *app, bool flip)
+/**
+ * All clocks get the same time of toggling, so they show the same value even
+ * if their threads handle it later.
+ */
+static void _flipclock_toggle_counter(struct flipclock *app)
 {
 	RETURN_IF_FAIL(app != NULL);
 
+	if (!app->counter)
+		return;
+	const Uint64 now = SDL_GetPerformanceCounter();
 	for (int i = 0; i < app->clocks_length; ++i) {
 		if (app->clocks[i] == NULL)
 			continue;
-		char text[3];
-		strftime(text, sizeof(text), "%S", &app->now);
-		flipclock_clock_set_second(app->clocks[i], text, flip);
+		flipclock_clock_toggle_counter(app->clocks[i], now);
 	}
 }
 
-static void _flipclock_animate(struct flipclock *app)
+static void _flipclock_reset_counter(struct flipclock *app)
 {
 	RETURN_IF_FAIL(app != NULL);
 
-	// Pause when minimized.
+	if (!app->counter)
+		return;
 	for (int i = 0; i < app->clocks_length; ++i) {
 		if (app->clocks[i] == NULL)
 			continue;
-		if (!app->clocks[i]->waiting)
-			flipclock_clock_animate(app->clocks[i]);
+		flipclock_clock_reset_counter(app->clocks[i]);
 	}
 }
 
-static void _flipclock_handle_window_event(struct flipclock *app,
-					   SDL_Event event)
+/**
+ * Wait for the next frame of clocks in main thread, a running counter needs
+ * all frames that display shows. Otherwise there is nothing to draw before
+ * timer tells us the next displayed second or minute starts.
+ */
+static int _flipclock_get_timeout(struct flipclock *app)
+{
+	RETURN_VAL_IF_FAIL(app != NULL, 0);
+
+	int timeout = -1;
+	for (int i = 0; i < app->clocks_length; ++i) {
+		if (app->clocks[i] == NULL)
+			continue;
+		const int clock_timeout =
+			flipclock_clock_get_timeout(app->clocks[i]);
+		if (clock_timeout >= 0 &&
+		    (timeout < 0 || clock_timeout < timeout))
+			timeout = clock_timeout;
+	}
+	if (timeout >= 0)
+		return timeout;
+#if defined(_WIN32)
+	// We need to check whether preview window is closed.
+	if (app->preview)
+		return 1000;
+#endif
+	// Wait until next event.
+	return -1;
+}
+
+static void _flipclock_animate(struct flipclock *app)
 {
 	RETURN_IF_FAIL(app != NULL);
 
-	struct flipclock_clock *clock = NULL;
+	// Clocks in render threads do this by themselves.
 	for (int i = 0; i < app->clocks_length; ++i) {
-		// Ignore closed clocks.
 		if (app->clocks[i] == NULL)
 			continue;
-		if (event.window.windowID ==
-		    SDL_GetWindowID(app->clocks[i]->window)) {
-			clock = app->clocks[i];
-			break;
-		}
+		flipclock_clock_animate(app->clocks[i]);
 	}
-	if (clock == NULL) {
+}
+
+static void _flipclock_handle_window_event(struct flipclock *app,
+					   SDL_Event event)
+{
+	RETURN_IF_FAIL(app != NULL);
+
+	// Closed clocks are removed from router.
+	const int clock_i =
+		flipclock_router_find(app->router, event.window.windowID);
+	if (clock_i < 0 || app->clocks[clock_i] == NULL) {
 		LOG_ERROR("There is no running window that event belongs!\n");
 		// It should be safe to ignore this event.
 		return;
 	}
-	flipclock_clock_handle_window_event(clock, event);
+	// Clock is destroyed by handling it, so remove it before.
+	if (event.window.event == SDL_WINDOWEVENT_CLOSE)
+		flipclock_router_remove(app->router, event.window.windowID);
+	flipclock_clock_handle_window_event(app->clocks[clock_i], event);
 }
 
 static void _flipclock_handle_keydown(struct flipclock *app, SDL_Event event)
@@ -679,6 +1122,18 @@ static void _flipclock_handle_keydown(struct flipclock *app, SDL_Event event)
 		// Must set second text, because created card has empty text.
 		_flipclock_set_second(app, false);
 		break;
+	case SDLK_i:
+		LOG_DEBUG("Key `i` pressed.\n");
+		_flipclock_set_show_hud(app, !app->show_hud);
+		break;
+	case SDLK_SPACE:
+		LOG_DEBUG("Key `space` pressed.\n");
+		_flipclock_toggle_counter(app);
+		break;
+	case SDLK_r:
+		LOG_DEBUG("Key `r` pressed.\n");
+		_flipclock_reset_counter(app);
+		break;
 	default:
 		break;
 	}
@@ -688,6 +1143,13 @@ static void _flipclock_handle_event(struct flipclock *app, SDL_Event event)
 {
 	RETURN_IF_FAIL(app != NULL);
 
+	// Registered event type is not a constant so we cannot switch it.
+	if (app->timer != NULL && event.type == app->timer->event_type) {
+		time_t raw_time = flipclock_timer_get_tick_time(app->timer);
+		_flipclock_update_time(app, raw_time);
+		return;
+	}
+
 	switch (event.type) {
 #if defined(_WIN32)
 	/**
@@ -763,8 +1225,13 @@ static void _flipclock_handle_event(struct flipclock *app, SDL_Event event)
 		    event.tfinger.timestamp <
 			    app->last_touch_time + DOUBLE_TAP_INTERVAL_MS) {
 			LOG_DEBUG("Double tap detected.\n");
-			_flipclock_set_ampm(app, !app->ampm);
-			_flipclock_set_hour(app, false);
+			// Counter has no ampm, so double tap toggles it.
+			if (app->counter) {
+				_flipclock_toggle_counter(app);
+			} else {
+				_flipclock_set_ampm(app, !app->ampm);
+				_flipclock_set_hour(app, false);
+			}
 		}
 		app->last_touch_time = event.tfinger.timestamp;
 		app->last_touch_finger = event.tfinger.fingerId;
@@ -796,6 +1263,61 @@ static void _flipclock_handle_event(struct flipclock *app, SDL_Event event)
 	}
 }
 
+/**
+ * Returns true if a later event in the batch makes this one useless, like
+ * window size changes, only the last size matters. Clocks also redraw for
+ * the last expose once, and timer ticks carry the time they are for.
+ */
+static bool _flipclock_is_superseded(const struct flipclock *app,
+				     const SDL_Event events[],
+				     int events_length, int i)
+{
+	RETURN_VAL_IF_FAIL(app != NULL, false);
+	RETURN_VAL_IF_FAIL(events != NULL, false);
+
+	const SDL_Event *event = &events[i];
+	const bool is_tick = app->timer != NULL &&
+			     event->type == app->timer->event_type;
+	const bool is_window =
+		event->type == SDL_WINDOWEVENT &&
+		(event->window.event == SDL_WINDOWEVENT_SIZE_CHANGED ||
+		 event->window.event == SDL_WINDOWEVENT_EXPOSED);
+	if (!is_tick && !is_window && event->type != SDL_MOUSEMOTION)
+		return false;
+	for (int j = i + 1; j < events_length; ++j) {
+		const SDL_Event *later = &events[j];
+		if (later->type != event->type)
+			continue;
+		// Window is closed, don't resize or expose it.
+		if (is_window &&
+		    later->window.windowID == event->window.windowID &&
+		    (later->window.event == event->window.event ||
+		     later->window.event == SDL_WINDOWEVENT_CLOSE))
+			return true;
+		if (!is_window)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Handle all events that arrived since last frame before drawing next one,
+ * so a burst of touches or resizes won't be applied a frame at a time.
+ */
+static void _flipclock_handle_events(struct flipclock *app,
+				     const SDL_Event events[],
+				     int events_length)
+{
+	RETURN_IF_FAIL(app != NULL);
+	RETURN_IF_FAIL(events != NULL);
+
+	for (int i = 0; i < events_length && app->running; ++i) {
+		if (_flipclock_is_superseded(app, events, events_length, i))
+			continue;
+		_flipclock_handle_event(app, events[i]);
+	}
+}
+
 void flipclock_run_mainloop(struct flipclock *app)
 {
 	RETURN_IF_FAIL(app != NULL);
@@ -804,34 +1326,44 @@ void flipclock_run_mainloop(struct flipclock *app)
 	// Clear event queue before running.
 	while (SDL_PollEvent(&event))
 		;
-	// First frame when app starts.
-	_flipclock_set_ampm(app, app->ampm);
-	_flipclock_set_hour(app, false);
-	_flipclock_set_minute(app, false);
-	if (app->show_second)
-		_flipclock_set_second(app, false);
+	/**
+	 * Clocks got time when they were created, see
+	 * `_flipclock_start_clock()`, but a boundary may be crossed while
+	 * creating others, and the timer only ticks on the next one.
+	 */
+	_flipclock_update_time(app, flipclock_zone_get_now(app->zone));
 	_flipclock_animate(app);
+	// Counters are driven by frames instead of ticks.
+	if (!app->counter)
+		app->timer = flipclock_timer_create(app->show_second ? 1 : 60);
 	while (app->running) {
 #if defined(_WIN32)
 		// Exit when preview window closed.
 		if (app->preview && !IsWindow(app->preview_window))
 			app->running = false;
 #endif
-		if (SDL_WaitEventTimeout(&event, 1000 / FPS))
-			_flipclock_handle_event(app, event);
-		struct tm past = app->now;
-		time_t raw_time = time(NULL);
-		app->now = *localtime(&raw_time);
-		if (app->now.tm_hour != past.tm_hour) {
-			_flipclock_set_ampm(app, app->ampm);
-			_flipclock_set_hour(app, true);
+		SDL_Event events[MAX_EVENTS];
+		int events_length = 0;
+		// Waiting pumps events, so take all queued events after it.
+		if (SDL_WaitEventTimeout(&events[0],
+					 _flipclock_get_timeout(app))) {
+			events_length = 1;
+			const int peeked = SDL_PeepEvents(
+				events + 1, MAX_EVENTS - 1, SDL_GETEVENT,
+				SDL_FIRSTEVENT, SDL_LASTEVENT);
+			if (peeked > 0)
+				events_length += peeked;
 		}
-		if (app->now.tm_min != past.tm_min)
-			_flipclock_set_minute(app, true);
-		if (app->show_second && app->now.tm_sec != past.tm_sec)
-			_flipclock_set_second(app, true);
+		_flipclock_handle_events(app, events, events_length);
+		// Zone or realtime changed, and next tick may be far away.
+		if (flipclock_zone_check(app->zone))
+			_flipclock_update_time(
+				app, flipclock_zone_get_now(app->zone));
 		_flipclock_animate(app);
 	}
+	if (app->timer != NULL)
+		flipclock_timer_destroy(app->timer);
+	app->timer = NULL;
 }
 
 void flipclock_destroy_clocks(struct flipclock *app)
@@ -844,6 +1376,27 @@ void flipclock_destroy_clocks(struct flipclock *app)
 		flipclock_clock_destroy(app->clocks[i]);
 	}
 	free(app->clocks);
+	flipclock_router_destroy(app->router);
+	app->router = NULL;
+	// Cards waited for their jobs, so workers are idle now.
+	if (app->workers != NULL) {
+		flipclock_workers_destroy(app->workers);
+		app->workers = NULL;
+	}
+	if (app->sdf != NULL) {
+		flipclock_sdf_destroy(app->sdf);
+		app->sdf = NULL;
+	}
+	if (app->cache != NULL) {
+		flipclock_cache_destroy(app->cache);
+		app->cache = NULL;
+	}
+	flipclock_fonts_destroy(app->fonts);
+	app->fonts = NULL;
+	if (app->stats_file != NULL) {
+		fclose(app->stats_file);
+		app->stats_file = NULL;
+	}
 	if (app->full)
 		SDL_ShowCursor(SDL_ENABLE);
 #if defined(_WIN32)
@@ -858,6 +1411,8 @@ void flipclock_destroy(struct flipclock *app)
 {
 	RETURN_IF_FAIL(app != NULL);
 
+	_flipclock_destroy_zones(app);
+	flipclock_zone_destroy(app->zone);
 	free(app);
 }
 
@@ -893,5 +1448,6 @@ void flipclock_print_help(struct flipclock *app, char program_name[])
 	printf("Press s to toggle second.\n");
 	printf("Press f to toggle fullscreen.\n");
 	printf("Press t to toggle 12/24-hour clock format.\n");
+	printf("Press i to toggle frame timings.\n");
 	printf("Using configuration file %s.\n", app->conf_path);
 }
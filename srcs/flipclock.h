@@ -9,6 +9,8 @@
 
 #include <SDL.h>
 
+#include "worker.h"
+
 #if defined(_WIN32)
 #	include <windows.h>
 #endif
@@ -65,15 +67,49 @@ struct flipclock {
 	struct flipclock_clock **clocks;
 	// Number of clocks.
 	int clocks_length;
+	// Finds index of clock by window ID.
+	struct flipclock_router *router;
 	// Structures shared by clocks.
-	struct tm now;
+	struct flipclock_timer *timer;
+	// Converts time without asking C library every tick.
+	struct flipclock_zone *zone;
+	/**
+	 * Timezones of clocks by index from `timezones`, NULL uses local
+	 * timezone. All clocks convert the same `now_time`.
+	 */
+	struct flipclock_zone **zones;
+	int zones_length;
+	time_t now_time;
 	SDL_Color box_color;
 	SDL_Color text_color;
 	SDL_Color background_color;
 	char font_path[MAX_BUFFER_LENGTH];
 	char conf_path[MAX_BUFFER_LENGTH];
+	// Frame timings of clocks are written here on exit if set.
+	char stats_path[MAX_BUFFER_LENGTH];
+	FILE *stats_file;
+	// Spans of startup and frames are written here on exit if set.
+	char trace_path[MAX_BUFFER_LENGTH];
 	double text_scale;
 	double card_scale;
+	struct flipclock_fonts *fonts;
+	/**
+	 * Fonts, distance field and cache are loaded by it while creating
+	 * windows, wait for it before using them.
+	 */
+	struct flipclock_job resources_job;
+	// Set before creating clocks if the job is pushed, then never changed.
+	bool resources_loading;
+	// Rasterize glyphs out of render threads, NULL means no workers.
+	struct flipclock_workers *workers;
+	// Less than 0 means deciding by CPU cores, 0 disables workers.
+	int worker_threads;
+	// Glyphs of all sizes are sampled from it, NULL means using fonts.
+	struct flipclock_sdf *sdf;
+	// Rasterized glyphs are loaded from it, NULL means no cache.
+	struct flipclock_cache *cache;
+	// Clocks report how long it takes to present their first frames.
+	Uint64 start_counter;
 #if defined(_WIN32)
 	HWND preview_window;
 	bool preview;
@@ -83,6 +119,18 @@ struct flipclock {
 	bool ampm;
 	bool full;
 	bool show_second;
+	/**
+	 * Show a stopwatch or a countdown instead of time, see `counter.h`.
+	 * Countdown is in centiseconds, 0 means stopwatch.
+	 */
+	bool counter;
+	long long countdown;
+	bool render_threads;
+	// Always compose faces by CPU, it is also used by software renderers.
+	bool cpu_compose;
+	bool sdf_glyphs;
+	bool glyph_cache;
+	bool show_hud;
 	long long last_touch_time;
 	SDL_FingerID last_touch_finger;
 	bool running;
@@ -91,6 +139,7 @@ struct flipclock {
 struct flipclock *flipclock_create(void);
 void flipclock_load_conf(struct flipclock *app);
 void flipclock_create_clocks(struct flipclock *app);
+void flipclock_wait_resources(struct flipclock *app);
 void flipclock_refresh(struct flipclock *app, int clock_index);
 void flipclock_create_textures(struct flipclock *app, int clock_index);
 void flipclock_destroy_textures(struct flipclock *app, int clock_index);
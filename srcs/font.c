@@ -0,0 +1,173 @@
+// We need `mmap()` with `-std=c11`.
+#if !defined(_WIN32)
+#	define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipclock.h"
+#include "font.h"
+
+/**
+ * Android fonts are inside APK assets and only SDL can read them, other
+ * platforms without `mmap()` just read the whole file into memory.
+ */
+#if (defined(__linux__) || defined(__APPLE__)) && !defined(__ANDROID__)
+#	define HAVE_MMAP
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#if defined(HAVE_MMAP)
+static void *_flipclock_fonts_map_file(const char font_path[], size_t *size)
+{
+	RETURN_VAL_IF_FAIL(font_path != NULL, NULL);
+	RETURN_VAL_IF_FAIL(size != NULL, NULL);
+
+	int fd = open(font_path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	if (fstat(fd, &st) < 0 || st.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// Mapping is still valid after closing file.
+	close(fd);
+	if (data == MAP_FAILED)
+		return NULL;
+	*size = st.st_size;
+	return data;
+}
+#endif
+
+struct flipclock_fonts *flipclock_fonts_create(const char font_path[])
+{
+	RETURN_VAL_IF_FAIL(font_path != NULL, NULL);
+
+	struct flipclock_fonts *fonts = malloc(sizeof(*fonts));
+	if (fonts == NULL) {
+		LOG_ERROR("Failed to create fonts!\n");
+		exit(EXIT_FAILURE);
+	}
+	fonts->fonts_length = 0;
+	fonts->data = NULL;
+	fonts->data_size = 0;
+	fonts->mapped = false;
+	LOG_DEBUG("Loading font from `%s`.\n", font_path);
+#if defined(HAVE_MMAP)
+	fonts->data = _flipclock_fonts_map_file(font_path, &fonts->data_size);
+	if (fonts->data != NULL)
+		fonts->mapped = true;
+#endif
+	if (fonts->data == NULL)
+		fonts->data = SDL_LoadFile(font_path, &fonts->data_size);
+	if (fonts->data == NULL) {
+		LOG_ERROR("Failed to load font from `%s`!\n", font_path);
+		exit(EXIT_FAILURE);
+	}
+	// SDL mutexes are recursive, so we can lock it again when opening.
+	fonts->mutex = SDL_CreateMutex();
+	if (fonts->mutex == NULL) {
+		LOG_ERROR("%s\n", SDL_GetError());
+		exit(EXIT_FAILURE);
+	}
+	return fonts;
+}
+
+void flipclock_fonts_lock(struct flipclock_fonts *fonts)
+{
+	RETURN_IF_FAIL(fonts != NULL);
+
+	SDL_LockMutex(fonts->mutex);
+}
+
+void flipclock_fonts_unlock(struct flipclock_fonts *fonts)
+{
+	RETURN_IF_FAIL(fonts != NULL);
+
+	SDL_UnlockMutex(fonts->mutex);
+}
+
+TTF_Font *flipclock_fonts_open(struct flipclock_fonts *fonts, int size)
+{
+	RETURN_VAL_IF_FAIL(fonts != NULL, NULL);
+
+	// FreeType does not like zero size, happens with very small window.
+	if (size < 1)
+		size = 1;
+	TTF_Font *font = NULL;
+	flipclock_fonts_lock(fonts);
+	for (int i = 0; i < fonts->fonts_length; ++i) {
+		if (fonts->fonts[i].size == size) {
+			++fonts->fonts[i].refs;
+			font = fonts->fonts[i].font;
+			break;
+		}
+	}
+	if (font == NULL) {
+		if (fonts->fonts_length == MAX_FONTS) {
+			LOG_ERROR("Too many fonts opened!\n");
+			exit(EXIT_FAILURE);
+		}
+		LOG_DEBUG("Opening font with size `%d`.\n", size);
+		// Let SDL_ttf free RWops, we free data by ourselves.
+		font = TTF_OpenFontRW(
+			SDL_RWFromConstMem(fonts->data, fonts->data_size), 1,
+			size);
+		if (font == NULL) {
+			LOG_ERROR("%s\n", TTF_GetError());
+			exit(EXIT_FAILURE);
+		}
+		fonts->fonts[fonts->fonts_length].font = font;
+		fonts->fonts[fonts->fonts_length].size = size;
+		fonts->fonts[fonts->fonts_length].refs = 1;
+		++fonts->fonts_length;
+	}
+	flipclock_fonts_unlock(fonts);
+	return font;
+}
+
+void flipclock_fonts_close(struct flipclock_fonts *fonts, TTF_Font *font)
+{
+	RETURN_IF_FAIL(fonts != NULL);
+	RETURN_IF_FAIL(font != NULL);
+
+	flipclock_fonts_lock(fonts);
+	for (int i = 0; i < fonts->fonts_length; ++i) {
+		struct flipclock_font *entry = &fonts->fonts[i];
+		if (entry->font != font)
+			continue;
+		if (--entry->refs == 0) {
+			LOG_DEBUG("Closing font with size `%d`.\n",
+				  entry->size);
+			TTF_CloseFont(entry->font);
+			// Order does not matter, move the last one here.
+			*entry = fonts->fonts[fonts->fonts_length - 1];
+			--fonts->fonts_length;
+		}
+		break;
+	}
+	flipclock_fonts_unlock(fonts);
+}
+
+void flipclock_fonts_destroy(struct flipclock_fonts *fonts)
+{
+	RETURN_IF_FAIL(fonts != NULL);
+
+	for (int i = 0; i < fonts->fonts_length; ++i)
+		TTF_CloseFont(fonts->fonts[i].font);
+#if defined(HAVE_MMAP)
+	if (fonts->mapped)
+		munmap(fonts->data, fonts->data_size);
+	else
+		SDL_free(fonts->data);
+#else
+	SDL_free(fonts->data);
+#endif
+	SDL_DestroyMutex(fonts->mutex);
+	free(fonts);
+}
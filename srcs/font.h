@@ -0,0 +1,42 @@
+#ifndef __FONT_H__
+#define __FONT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+// Cards in all clocks share the same size, so we won't have many sizes.
+#define MAX_FONTS 32
+
+struct flipclock_font {
+	TTF_Font *font;
+	int size;
+	int refs;
+};
+
+/**
+ * All cards and clocks share fonts opened from one in-memory copy of the font
+ * file, fonts are reference counted and shared by point size.
+ *
+ * FreeType is not thread-safe, so lock fonts before using fonts from the
+ * registry in different threads.
+ */
+struct flipclock_fonts {
+	SDL_mutex *mutex;
+	void *data;
+	size_t data_size;
+	bool mapped;
+	struct flipclock_font fonts[MAX_FONTS];
+	int fonts_length;
+};
+
+struct flipclock_fonts *flipclock_fonts_create(const char font_path[]);
+void flipclock_fonts_lock(struct flipclock_fonts *fonts);
+void flipclock_fonts_unlock(struct flipclock_fonts *fonts);
+TTF_Font *flipclock_fonts_open(struct flipclock_fonts *fonts, int size);
+void flipclock_fonts_close(struct flipclock_fonts *fonts, TTF_Font *font);
+void flipclock_fonts_destroy(struct flipclock_fonts *fonts);
+
+#endif
@@ -0,0 +1,124 @@
+#include <string.h>
+
+#include "flipclock.h"
+#include "layout.h"
+#include "trace.h"
+
+/**
+ * space/card = 1/8. In best condition, a line of 2 cards is 1 + 8 + 1 + 8 + 1.
+ * However, the other length of window might be smaller, and the card is less
+ * than 8. We will enlarge the spaces of begining and end, so only care about
+ * spaces between cards when calculating position.
+ */
+static int _flipclock_layout_get_space(int length, int cards_length)
+{
+	return length / (cards_length * 8 + cards_length + 1);
+}
+
+static int _flipclock_layout_get_card_size(int w, int h, int rows,
+					   int columns)
+{
+	const int max_w = w * 8 / (columns * 8 + columns + 1);
+	const int max_h = h * 8 / (rows * 8 + rows + 1);
+	return max_w < max_h ? max_w : max_h;
+}
+
+/**
+ * Prefer one line, because hour and minute are read as a line. Many cards in
+ * one line are too small, so try grids of every number of columns.
+ */
+static void _flipclock_layout_find_grid(struct flipclock_layout *layout)
+{
+	RETURN_IF_FAIL(layout != NULL);
+
+	const int cards_length = layout->cards_length;
+	if (layout->w >= layout->h) {
+		layout->rows = 1;
+		layout->columns = cards_length;
+	} else {
+		layout->rows = cards_length;
+		layout->columns = 1;
+	}
+	const int line_size = _flipclock_layout_get_card_size(
+		layout->w, layout->h, layout->rows, layout->columns);
+	int best_size = line_size;
+	for (int columns = 1; columns <= cards_length; ++columns) {
+		const int rows = (cards_length + columns - 1) / columns;
+		const int size = _flipclock_layout_get_card_size(
+			layout->w, layout->h, rows, columns);
+		if (size > best_size && size > line_size * LAYOUT_GRID_GAIN) {
+			best_size = size;
+			layout->rows = rows;
+			layout->columns = columns;
+		}
+	}
+}
+
+static void _flipclock_layout_place(struct flipclock_layout *layout)
+{
+	RETURN_IF_FAIL(layout != NULL);
+
+	const int rows = layout->rows;
+	const int columns = layout->columns;
+	int card_size = _flipclock_layout_get_card_size(layout->w, layout->h,
+							rows, columns);
+	card_size *= layout->card_scale;
+	const int space_w = _flipclock_layout_get_space(layout->w, columns);
+	const int space_h = _flipclock_layout_get_space(layout->h, rows);
+	const int y = (layout->h - card_size * rows - space_h * (rows - 1)) / 2;
+	for (int i = 0; i < layout->cards_length; ++i) {
+		const int row = i / columns;
+		const int column = i % columns;
+		// Center the last row if it is not full.
+		int row_columns = layout->cards_length - row * columns;
+		if (row_columns > columns)
+			row_columns = columns;
+		const int x = (layout->w - card_size * row_columns -
+			       space_w * (row_columns - 1)) /
+			      2;
+		layout->rects[i].x = x + (card_size + space_w) * column;
+		layout->rects[i].y = y + (card_size + space_h) * row;
+		layout->rects[i].w = card_size;
+		layout->rects[i].h = card_size;
+	}
+}
+
+void flipclock_layout_init(struct flipclock_layout *layout)
+{
+	RETURN_IF_FAIL(layout != NULL);
+
+	layout->w = 0;
+	layout->h = 0;
+	layout->cards_length = 0;
+	layout->card_scale = 0.0;
+	layout->rows = 0;
+	layout->columns = 0;
+	memset(layout->rects, 0, sizeof(layout->rects));
+}
+
+// Returns true if rects are calculated again.
+bool flipclock_layout_update(struct flipclock_layout *layout, int w, int h,
+			     int cards_length, double card_scale)
+{
+	RETURN_VAL_IF_FAIL(layout != NULL, false);
+	RETURN_VAL_IF_FAIL(cards_length >= 0 && cards_length <= MAX_CARDS,
+			   false);
+
+	if (w == layout->w && h == layout->h &&
+	    cards_length == layout->cards_length &&
+	    card_scale == layout->card_scale)
+		return false;
+	const Uint64 trace_start = flipclock_trace_begin();
+	layout->w = w;
+	layout->h = h;
+	layout->cards_length = cards_length;
+	layout->card_scale = card_scale;
+	if (cards_length != 0) {
+		_flipclock_layout_find_grid(layout);
+		_flipclock_layout_place(layout);
+	}
+	LOG_DEBUG("Placing `%d` cards in `%dx%d` grid for size `%dx%d`.\n",
+		  cards_length, layout->columns, layout->rows, w, h);
+	flipclock_trace_end(__func__, trace_start);
+	return true;
+}
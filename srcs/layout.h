@@ -0,0 +1,33 @@
+#ifndef __LAYOUT_H__
+#define __LAYOUT_H__
+
+#include <stdbool.h>
+
+#include <SDL.h>
+
+// Layers mark cards with bits of `unsigned int`.
+#define MAX_CARDS 32
+// Use a grid only if its cards are more than this times larger than a line.
+#define LAYOUT_GRID_GAIN 1.5
+
+/**
+ * Rects of square cards in a window. Cards are placed in one line along the
+ * longer side of window, or in a grid if it makes cards much larger, like a
+ * video wall of many cards. Rects are only calculated again if size, number
+ * of cards or scale changed.
+ */
+struct flipclock_layout {
+	int w;
+	int h;
+	int cards_length;
+	double card_scale;
+	int rows;
+	int columns;
+	SDL_Rect rects[MAX_CARDS];
+};
+
+void flipclock_layout_init(struct flipclock_layout *layout);
+bool flipclock_layout_update(struct flipclock_layout *layout, int w, int h,
+			     int cards_length, double card_scale);
+
+#endif
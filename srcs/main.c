@@ -10,10 +10,11 @@
 
 #include "getarg.h"
 #include "flipclock.h"
+#include "trace.h"
 
 int main(int argc, char *argv[])
 {
-	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0) {
 		LOG_ERROR("%s\n", SDL_GetError());
 		exit(EXIT_FAILURE);
 	}
@@ -22,10 +23,14 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 	SDL_SetHint(SDL_HINT_VIDEO_MINIMIZE_ON_FOCUS_LOSS, "0");
+	flipclock_trace_create();
 	struct flipclock *app = flipclock_create();
+	Uint64 trace_start = 0;
 #if !defined(__ANDROID__)
 	// Android don't need conf and arguments.
+	trace_start = flipclock_trace_begin();
 	flipclock_load_conf(app);
+	flipclock_trace_end("flipclock_load_conf", trace_start);
 #	if defined(__DEBUG__)
 	for (int i = 0; i < argc; ++i)
 		LOG_DEBUG("argv[%d]: %s\n", i, argv[i]);
@@ -139,13 +144,20 @@ int main(int argc, char *argv[])
 		goto exit;
 #endif
 
+	// We know whether to trace after loading configuration.
+	if (app->trace_path[0] == '\0')
+		flipclock_trace_disable();
+	trace_start = flipclock_trace_begin();
 	flipclock_create_clocks(app);
+	flipclock_trace_end("flipclock_create_clocks", trace_start);
 
 	flipclock_run_mainloop(app);
 
 	flipclock_destroy_clocks(app);
 
 exit:
+	// All render threads are stopped now.
+	flipclock_trace_destroy(app->trace_path);
 	flipclock_destroy(app);
 	TTF_Quit();
 	SDL_Quit();
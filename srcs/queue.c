@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipclock.h"
+#include "queue.h"
+
+struct flipclock_queue *flipclock_queue_create(void)
+{
+	struct flipclock_queue *queue = malloc(sizeof(*queue));
+	if (queue == NULL) {
+		LOG_ERROR("Failed to create queue!\n");
+		exit(EXIT_FAILURE);
+	}
+	SDL_AtomicSet(&queue->head, 0);
+	SDL_AtomicSet(&queue->tail, 0);
+	queue->sem = SDL_CreateSemaphore(0);
+	if (queue->sem == NULL) {
+		LOG_ERROR("%s\n", SDL_GetError());
+		exit(EXIT_FAILURE);
+	}
+	queue->handle = NULL;
+	queue->data = NULL;
+	return queue;
+}
+
+// Only call this if producer thread also pops messages, before pushing any.
+void flipclock_queue_set_handle(struct flipclock_queue *queue,
+				flipclock_queue_func handle, void *data)
+{
+	RETURN_IF_FAIL(queue != NULL);
+
+	queue->handle = handle;
+	queue->data = data;
+}
+
+// Only call this in producer thread.
+void flipclock_queue_push(struct flipclock_queue *queue,
+			  const struct flipclock_message *message)
+{
+	RETURN_IF_FAIL(queue != NULL);
+	RETURN_IF_FAIL(message != NULL);
+
+	const int tail = SDL_AtomicGet(&queue->tail);
+	// Nobody else drains it, so handle old messages in order first.
+	if (queue->handle != NULL &&
+	    tail - SDL_AtomicGet(&queue->head) >= MAX_MESSAGES) {
+		struct flipclock_message queued;
+		while (flipclock_queue_pop(queue, &queued))
+			queue->handle(queue->data, &queued);
+	}
+	/**
+	 * Consumer drains queue every frame so it should never be full, if it
+	 * happens, consumer is busy and we have to wait it, dropping messages
+	 * will make cards display wrong texts.
+	 */
+	while (tail - SDL_AtomicGet(&queue->head) >= MAX_MESSAGES) {
+		SDL_SemPost(queue->sem);
+		SDL_Delay(1);
+	}
+	queue->messages[tail & (MAX_MESSAGES - 1)] = *message;
+	// Message must be written before consumer sees new tail.
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&queue->tail, tail + 1);
+	SDL_SemPost(queue->sem);
+}
+
+// Only call this in consumer thread.
+bool flipclock_queue_pop(struct flipclock_queue *queue,
+			 struct flipclock_message *message)
+{
+	RETURN_VAL_IF_FAIL(queue != NULL, false);
+	RETURN_VAL_IF_FAIL(message != NULL, false);
+
+	const int head = SDL_AtomicGet(&queue->head);
+	if (head == SDL_AtomicGet(&queue->tail))
+		return false;
+	// Don't read message before we see new tail.
+	SDL_MemoryBarrierAcquire();
+	*message = queue->messages[head & (MAX_MESSAGES - 1)];
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&queue->head, head + 1);
+	return true;
+}
+
+bool flipclock_queue_is_empty(struct flipclock_queue *queue)
+{
+	RETURN_VAL_IF_FAIL(queue != NULL, true);
+
+	return SDL_AtomicGet(&queue->head) == SDL_AtomicGet(&queue->tail);
+}
+
+/**
+ * Block consumer until there are messages or timeout, a negative timeout means
+ * waiting forever.
+ */
+void flipclock_queue_wait(struct flipclock_queue *queue, int timeout)
+{
+	RETURN_IF_FAIL(queue != NULL);
+
+	if (!flipclock_queue_is_empty(queue))
+		return;
+	if (timeout < 0)
+		SDL_SemWait(queue->sem);
+	else
+		SDL_SemWaitTimeout(queue->sem, timeout);
+	// We drain all messages after waking up, so drop other posts.
+	while (SDL_SemTryWait(queue->sem) == 0)
+		;
+}
+
+void flipclock_queue_destroy(struct flipclock_queue *queue)
+{
+	RETURN_IF_FAIL(queue != NULL);
+
+	SDL_DestroySemaphore(queue->sem);
+	free(queue);
+}
@@ -0,0 +1,73 @@
+#ifndef __QUEUE_H__
+#define __QUEUE_H__
+
+#include <stdbool.h>
+
+#include <SDL.h>
+
+#include "card.h"
+
+// Must be power of 2 so we can use mask for ring buffer index.
+#define MAX_MESSAGES 64
+
+enum flipclock_message_type {
+	FLIPCLOCK_MESSAGE_TEXT,
+	FLIPCLOCK_MESSAGE_SUB_TEXT,
+	FLIPCLOCK_MESSAGE_NEXT_TEXT,
+	FLIPCLOCK_MESSAGE_SHOW_SECOND,
+	FLIPCLOCK_MESSAGE_SHOW_HUD,
+	FLIPCLOCK_MESSAGE_RESIZE,
+	FLIPCLOCK_MESSAGE_EXPOSE,
+	FLIPCLOCK_MESSAGE_WAIT,
+	FLIPCLOCK_MESSAGE_TOGGLE_COUNTER,
+	FLIPCLOCK_MESSAGE_RESET_COUNTER,
+	FLIPCLOCK_MESSAGE_QUIT
+};
+
+struct flipclock_message {
+	enum flipclock_message_type type;
+	// Index of card for texts, messages for cards not shown are dropped.
+	int card_i;
+	// Text can be NULL to clear card, so we need a flag for it.
+	bool has_text;
+	char text[MAX_TEXT_LENGTH];
+	// Means `flip` for texts, and new value for other switches.
+	bool flag;
+	int w;
+	int h;
+	// Performance counter when main thread toggles counter.
+	Uint64 tick;
+};
+
+typedef void (*flipclock_queue_func)(void *data,
+				     const struct flipclock_message *message);
+
+/**
+ * A lock-free single producer single consumer ring buffer, main thread pushes
+ * messages and render thread pops them. The semaphore is only used to wake up
+ * a blocked consumer.
+ *
+ * If producer is also consumer, it can't wait for itself to drain a full
+ * queue, set `handle` so producer handles queued messages before pushing.
+ */
+struct flipclock_queue {
+	struct flipclock_message messages[MAX_MESSAGES];
+	SDL_atomic_t head;
+	SDL_atomic_t tail;
+	SDL_sem *sem;
+	flipclock_queue_func handle;
+	void *data;
+};
+
+struct flipclock_queue *flipclock_queue_create(void);
+void flipclock_queue_set_handle(struct flipclock_queue *queue,
+				flipclock_queue_func handle, void *data);
+void flipclock_queue_push(struct flipclock_queue *queue,
+			  const struct flipclock_message *message);
+bool flipclock_queue_pop(struct flipclock_queue *queue,
+			 struct flipclock_message *message);
+bool flipclock_queue_is_empty(struct flipclock_queue *queue);
+void flipclock_queue_wait(struct flipclock_queue *queue, int timeout);
+void flipclock_queue_destroy(struct flipclock_queue *queue);
+
+#endif
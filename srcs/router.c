@@ -0,0 +1,103 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipclock.h"
+#include "router.h"
+
+// Window IDs are small and sequential, Fibonacci hashing spreads them.
+static int _flipclock_router_hash(Uint32 window_id)
+{
+	return (window_id * 2654435769u) >> 16 & (MAX_ROUTES - 1);
+}
+
+struct flipclock_router *flipclock_router_create(void)
+{
+	struct flipclock_router *router = malloc(sizeof(*router));
+	if (router == NULL) {
+		LOG_ERROR("Failed to create router!\n");
+		exit(EXIT_FAILURE);
+	}
+	memset(router->routes, 0, sizeof(router->routes));
+	router->length = 0;
+	return router;
+}
+
+void flipclock_router_add(struct flipclock_router *router, Uint32 window_id,
+			  int clock_i)
+{
+	RETURN_IF_FAIL(router != NULL);
+	RETURN_IF_FAIL(window_id != 0);
+
+	int i = _flipclock_router_hash(window_id);
+	while (router->routes[i].window_id != 0 &&
+	       router->routes[i].window_id != window_id)
+		i = (i + 1) & (MAX_ROUTES - 1);
+	if (router->routes[i].window_id == 0) {
+		// Keep one slot empty, so probing always stops.
+		if (router->length == MAX_ROUTES - 1) {
+			LOG_ERROR("Too many windows!\n");
+			exit(EXIT_FAILURE);
+		}
+		++router->length;
+	}
+	router->routes[i].window_id = window_id;
+	router->routes[i].clock_i = clock_i;
+}
+
+// Returns -1 if there is no clock for the window.
+int flipclock_router_find(const struct flipclock_router *router,
+			  Uint32 window_id)
+{
+	RETURN_VAL_IF_FAIL(router != NULL, -1);
+
+	if (window_id == 0)
+		return -1;
+	int i = _flipclock_router_hash(window_id);
+	while (router->routes[i].window_id != 0) {
+		if (router->routes[i].window_id == window_id)
+			return router->routes[i].clock_i;
+		i = (i + 1) & (MAX_ROUTES - 1);
+	}
+	return -1;
+}
+
+void flipclock_router_remove(struct flipclock_router *router,
+			     Uint32 window_id)
+{
+	RETURN_IF_FAIL(router != NULL);
+
+	if (window_id == 0)
+		return;
+	int i = _flipclock_router_hash(window_id);
+	while (router->routes[i].window_id != window_id) {
+		if (router->routes[i].window_id == 0)
+			return;
+		i = (i + 1) & (MAX_ROUTES - 1);
+	}
+	router->routes[i].window_id = 0;
+	--router->length;
+	/**
+	 * Move back following entries that can't be found after the hole,
+	 * an entry stays if its home slot is between the hole and itself.
+	 */
+	int hole = i;
+	i = (i + 1) & (MAX_ROUTES - 1);
+	while (router->routes[i].window_id != 0) {
+		const int home =
+			_flipclock_router_hash(router->routes[i].window_id);
+		if (((i - home) & (MAX_ROUTES - 1)) >=
+		    ((i - hole) & (MAX_ROUTES - 1))) {
+			router->routes[hole] = router->routes[i];
+			router->routes[i].window_id = 0;
+			hole = i;
+		}
+		i = (i + 1) & (MAX_ROUTES - 1);
+	}
+}
+
+void flipclock_router_destroy(struct flipclock_router *router)
+{
+	RETURN_IF_FAIL(router != NULL);
+
+	free(router);
+}
@@ -0,0 +1,36 @@
+#ifndef __ROUTER_H__
+#define __ROUTER_H__
+
+#include <stdbool.h>
+
+#include <SDL.h>
+
+// Must be power of 2 so we can use mask for index, and larger than displays.
+#define MAX_ROUTES 64
+
+struct flipclock_route {
+	// SDL never uses 0 as window ID, so it marks an empty slot.
+	Uint32 window_id;
+	int clock_i;
+};
+
+/**
+ * A hash table from window IDs to indices of clocks, so window events don't
+ * need to compare with every clock. It uses linear probing, and removing an
+ * ID moves following entries back, so there are no tombstones.
+ */
+struct flipclock_router {
+	struct flipclock_route routes[MAX_ROUTES];
+	int length;
+};
+
+struct flipclock_router *flipclock_router_create(void);
+void flipclock_router_add(struct flipclock_router *router, Uint32 window_id,
+			  int clock_i);
+int flipclock_router_find(const struct flipclock_router *router,
+			  Uint32 window_id);
+void flipclock_router_remove(struct flipclock_router *router,
+			     Uint32 window_id);
+void flipclock_router_destroy(struct flipclock_router *router);
+
+#endif
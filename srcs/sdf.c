@@ -0,0 +1,427 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipclock.h"
+#include "sdf.h"
+#include "trace.h"
+
+#define SDF_INF 1e20f
+
+/**
+ * Squared distance transform of a sampled function in one dimension, see
+ * "Distance Transforms of Sampled Functions" by Felzenszwalb and Huttenlocher.
+ * It also gives which sample is the nearest one, by its index in `fi`.
+ * Buffers must have space for `n` values, and `n + 1` values for `z`.
+ */
+static void _flipclock_sdf_transform_1d(const float f[], const int fi[], int n,
+					float d[], int di[], int v[], float z[])
+{
+	int k = 0;
+	v[0] = 0;
+	z[0] = -SDF_INF;
+	z[1] = SDF_INF;
+	for (int q = 1; q < n; ++q) {
+		// Drop parabolas that are hidden by the new one.
+		float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) /
+			  (2.0f * (q - v[k]));
+		while (s <= z[k]) {
+			--k;
+			s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) /
+			    (2.0f * (q - v[k]));
+		}
+		++k;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = SDF_INF;
+	}
+	k = 0;
+	for (int q = 0; q < n; ++q) {
+		while (z[k + 1] < q)
+			++k;
+		d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+		di[q] = fi[v[k]];
+	}
+}
+
+/**
+ * Find the nearest pixel that is set in grid for every pixel, by transforming
+ * columns and then rows. Grid is replaced by squared distances.
+ */
+static void _flipclock_sdf_transform(float grid[], int nearest[], int w, int h)
+{
+	// Nothing to transform.
+	if (w <= 0 || h <= 0)
+		return;
+	const int n = w > h ? w : h;
+	// Compilers can't see columns are filled before reading them.
+	float *f = calloc(n, sizeof(*f));
+	float *d = malloc(n * sizeof(*d));
+	float *z = malloc((n + 1) * sizeof(*z));
+	int *v = malloc(n * sizeof(*v));
+	int *fi = calloc(n, sizeof(*fi));
+	int *di = malloc(n * sizeof(*di));
+	if (f == NULL || d == NULL || z == NULL || v == NULL || fi == NULL ||
+	    di == NULL) {
+		LOG_ERROR("Failed to create distance field!\n");
+		exit(EXIT_FAILURE);
+	}
+	for (int x = 0; x < w; ++x) {
+		for (int y = 0; y < h; ++y) {
+			f[y] = grid[y * w + x];
+			fi[y] = y * w + x;
+		}
+		_flipclock_sdf_transform_1d(f, fi, h, d, di, v, z);
+		for (int y = 0; y < h; ++y) {
+			grid[y * w + x] = d[y];
+			nearest[y * w + x] = di[y];
+		}
+	}
+	for (int y = 0; y < h; ++y) {
+		memcpy(f, grid + y * w, w * sizeof(*f));
+		memcpy(fi, nearest + y * w, w * sizeof(*fi));
+		_flipclock_sdf_transform_1d(f, fi, w, d, di, v, z);
+		memcpy(grid + y * w, d, w * sizeof(*d));
+		memcpy(nearest + y * w, di, w * sizeof(*di));
+	}
+	free(f);
+	free(d);
+	free(z);
+	free(v);
+	free(fi);
+	free(di);
+}
+
+/**
+ * Distance from center of an anti-aliased pixel to the edge, positive inside.
+ * Edge is a line with the given direction that covers alpha of the pixel, see
+ * "Anti-aliased Euclidean distance transform" by Gustavson and Strand.
+ */
+static float _flipclock_sdf_get_edge_distance(float gx, float gy, float a)
+{
+	if (gx == 0 || gy == 0)
+		return a - 0.5f;
+	const float length = sqrtf(gx * gx + gy * gy);
+	gx = fabsf(gx) / length;
+	gy = fabsf(gy) / length;
+	if (gx < gy) {
+		const float t = gx;
+		gx = gy;
+		gy = t;
+	}
+	const float a1 = 0.5f * gy / gx;
+	if (a < a1)
+		return sqrtf(2 * gx * gy * a) - 0.5f * (gx + gy);
+	if (a < 1 - a1)
+		return (a - 0.5f) * gx;
+	return 0.5f * (gx + gy) - sqrtf(2 * gx * gy * (1 - a));
+}
+
+/**
+ * Distance to an edge can't change faster than distance between pixels, so
+ * pixels that picked a farther edge pixel from some at the same distance are
+ * fixed by their neighbors, in a forward and a backward pass.
+ */
+static void _flipclock_sdf_relax(float distances[], const Uint8 alpha[], int w,
+				 int h)
+{
+	const float diagonal = sqrtf(2);
+	const int dx[4] = { -1, 1, 0, -1 };
+	const int dy[4] = { 0, -1, -1, -1 };
+	for (int pass = 0; pass < 2; ++pass) {
+		const int step = pass == 0 ? 1 : -1;
+		for (int k = 0; k < w * h; ++k) {
+			const int i = pass == 0 ? k : w * h - 1 - k;
+			if (alpha[i] != 0 && alpha[i] != 255)
+				continue;
+			const int x = i % w;
+			const int y = i / w;
+			for (int j = 0; j < 4; ++j) {
+				const int nx = x + dx[j] * step;
+				const int ny = y + dy[j] * step;
+				if (nx < 0 || nx >= w || ny < 0 || ny >= h)
+					continue;
+				const float gap = dx[j] != 0 && dy[j] != 0 ?
+							  diagonal :
+							  1;
+				const int n = ny * w + nx;
+				const float neighbor = distances[n];
+				/**
+				 * Pixels on the other side are only known to
+				 * be not closer, so they can't be used.
+				 */
+				if (alpha[i] == 255 && alpha[n] != 0 &&
+				    neighbor + gap < distances[i])
+					distances[i] = neighbor + gap;
+				if (alpha[i] == 0 && alpha[n] != 255 &&
+				    neighbor - gap > distances[i])
+					distances[i] = neighbor - gap;
+			}
+		}
+	}
+}
+
+/**
+ * Edge distances of anti-aliased pixels come from their alpha and gradient.
+ * Other pixels find the nearest pixel on the edge and add its edge distance,
+ * so edges stay smooth after scaling up. The nearest pixel on the other side
+ * is also checked, and neighbors fix the rest, because an edge pixel at the
+ * same distance may be closer to the edge.
+ */
+static void _flipclock_sdf_build(struct flipclock_sdf *sdf,
+				 const Uint8 alpha[])
+{
+	const int w = sdf->w;
+	const int h = sdf->h;
+	const int length = w * h;
+	float *edges = malloc(length * sizeof(*edges));
+	// Squared distances to pixels that are not inside, or not outside.
+	float *to_edge_outside = malloc(length * sizeof(*to_edge_outside));
+	float *to_edge_inside = malloc(length * sizeof(*to_edge_inside));
+	// Squared distances to pixels that are fully outside, or fully inside.
+	float *to_outside = malloc(length * sizeof(*to_outside));
+	float *to_inside = malloc(length * sizeof(*to_inside));
+	int *nearest_outside = malloc(length * sizeof(*nearest_outside));
+	int *nearest_inside = malloc(length * sizeof(*nearest_inside));
+	int *nearest = malloc(length * sizeof(*nearest));
+	if (edges == NULL || to_edge_outside == NULL ||
+	    to_edge_inside == NULL || to_outside == NULL || to_inside == NULL ||
+	    nearest_outside == NULL || nearest_inside == NULL ||
+	    nearest == NULL) {
+		LOG_ERROR("Failed to create distance field!\n");
+		exit(EXIT_FAILURE);
+	}
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			const int i = y * w + x;
+			const float a = alpha[i] / 255.0f;
+			edges[i] = a >= 0.5f ? 0.5f : -0.5f;
+			if (alpha[i] > 0 && alpha[i] < 255 && x > 0 &&
+			    x < w - 1 && y > 0 && y < h - 1) {
+				// Sobel gradient, only its direction is used.
+				const Uint8 *p = alpha + i;
+				const float gx = p[-w + 1] + 2 * p[1] +
+						 p[w + 1] - p[-w - 1] -
+						 2 * p[-1] - p[w - 1];
+				const float gy = p[w - 1] + 2 * p[w] +
+						 p[w + 1] - p[-w - 1] -
+						 2 * p[-w] - p[-w + 1];
+				edges[i] = _flipclock_sdf_get_edge_distance(
+					gx, gy, a);
+			}
+			to_edge_outside[i] = alpha[i] < 255 ? 0 : SDF_INF;
+			to_edge_inside[i] = alpha[i] > 0 ? 0 : SDF_INF;
+			to_outside[i] = alpha[i] == 0 ? 0 : SDF_INF;
+			to_inside[i] = alpha[i] == 255 ? 0 : SDF_INF;
+		}
+	}
+	_flipclock_sdf_transform(to_edge_outside, nearest_outside, w, h);
+	_flipclock_sdf_transform(to_edge_inside, nearest_inside, w, h);
+	_flipclock_sdf_transform(to_outside, nearest, w, h);
+	_flipclock_sdf_transform(to_inside, nearest, w, h);
+	// Each value is read before it is replaced, so reuse it for results.
+	float *distances = to_inside;
+	for (int i = 0; i < length; ++i) {
+		float distance = edges[i];
+		if (alpha[i] == 255) {
+			distance = sqrtf(to_edge_outside[i]) +
+				   edges[nearest_outside[i]];
+			if (sqrtf(to_outside[i]) - 0.5f < distance)
+				distance = sqrtf(to_outside[i]) - 0.5f;
+		} else if (alpha[i] == 0) {
+			distance = edges[nearest_inside[i]] -
+				   sqrtf(to_edge_inside[i]);
+			if (0.5f - sqrtf(to_inside[i]) > distance)
+				distance = 0.5f - sqrtf(to_inside[i]);
+		}
+		distances[i] = distance;
+	}
+	_flipclock_sdf_relax(distances, alpha, w, h);
+	for (int i = 0; i < length; ++i) {
+		const float distance = distances[i];
+		float value =
+			SDF_EDGE + distance * SDF_EDGE / SDF_SPREAD + 0.5f;
+		if (value < 0)
+			value = 0;
+		if (value > 2 * SDF_EDGE)
+			value = 2 * SDF_EDGE;
+		sdf->field[i] = value;
+	}
+	free(edges);
+	free(to_edge_outside);
+	free(to_edge_inside);
+	free(to_outside);
+	free(to_inside);
+	free(nearest_outside);
+	free(nearest_inside);
+	free(nearest);
+}
+
+/**
+ * Only used once before creating clocks, so it is fine to use FreeType here,
+ * glyphs are placed in one row with `SDF_SPREAD` around each one.
+ */
+struct flipclock_sdf *flipclock_sdf_create(struct flipclock_fonts *fonts)
+{
+	RETURN_VAL_IF_FAIL(fonts != NULL, NULL);
+
+	const Uint64 trace_start = flipclock_trace_begin();
+	struct flipclock_sdf *sdf = malloc(sizeof(*sdf));
+	if (sdf == NULL) {
+		LOG_ERROR("Failed to create distance field!\n");
+		exit(EXIT_FAILURE);
+	}
+	const SDL_Color white = { 0xff, 0xff, 0xff, 0xff };
+	SDL_Surface *glyphs[ATLAS_GLYPHS_LENGTH];
+	TTF_Font *font = flipclock_fonts_open(fonts, SDF_FONT_SIZE);
+	flipclock_fonts_lock(fonts);
+	sdf->w = 0;
+	sdf->h = 0;
+	for (int i = 0; i < ATLAS_GLYPHS_LENGTH; ++i) {
+		glyphs[i] = TTF_RenderGlyph_Blended(font, ATLAS_GLYPHS[i],
+						    white);
+		if (glyphs[i] == NULL) {
+			LOG_ERROR("%s\n", TTF_GetError());
+			exit(EXIT_FAILURE);
+		}
+		sdf->rects[i].x = sdf->w + SDF_SPREAD;
+		sdf->rects[i].y = SDF_SPREAD;
+		sdf->rects[i].w = glyphs[i]->w;
+		sdf->rects[i].h = glyphs[i]->h;
+		sdf->w += glyphs[i]->w + 2 * SDF_SPREAD;
+		if (glyphs[i]->h + 2 * SDF_SPREAD > sdf->h)
+			sdf->h = glyphs[i]->h + 2 * SDF_SPREAD;
+	}
+	flipclock_fonts_unlock(fonts);
+	flipclock_fonts_close(fonts, font);
+
+	LOG_DEBUG("Creating distance field with size `%dx%d`.\n", sdf->w,
+		  sdf->h);
+	Uint8 *alpha = calloc(sdf->w * sdf->h, 1);
+	sdf->field = malloc(sdf->w * sdf->h * sizeof(*sdf->field));
+	if (alpha == NULL || sdf->field == NULL) {
+		LOG_ERROR("Failed to create distance field!\n");
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < ATLAS_GLYPHS_LENGTH; ++i) {
+		SDL_Surface *glyph = glyphs[i];
+		const SDL_Rect *rect = &sdf->rects[i];
+		SDL_LockSurface(glyph);
+		for (int y = 0; y < rect->h; ++y) {
+			const Uint32 *row =
+				(const Uint32 *)((Uint8 *)glyph->pixels +
+						 y * glyph->pitch);
+			Uint8 *alpha_row =
+				alpha + (rect->y + y) * sdf->w + rect->x;
+			for (int x = 0; x < rect->w; ++x)
+				alpha_row[x] = row[x] >> 24;
+		}
+		SDL_UnlockSurface(glyph);
+		SDL_FreeSurface(glyph);
+	}
+	_flipclock_sdf_build(sdf, alpha);
+	free(alpha);
+	flipclock_trace_end(__func__, trace_start);
+	return sdf;
+}
+
+// Glyph size for a font size, same as what FreeType gives with that size.
+void flipclock_sdf_get_glyph_size(const struct flipclock_sdf *sdf, int i,
+				  int size, int *w, int *h)
+{
+	RETURN_IF_FAIL(sdf != NULL);
+	RETURN_IF_FAIL(i >= 0 && i < ATLAS_GLYPHS_LENGTH);
+	RETURN_IF_FAIL(w != NULL);
+	RETURN_IF_FAIL(h != NULL);
+
+	if (size < 1)
+		size = 1;
+	*w = (sdf->rects[i].w * size + SDF_FONT_SIZE / 2) / SDF_FONT_SIZE;
+	*h = (sdf->rects[i].h * size + SDF_FONT_SIZE / 2) / SDF_FONT_SIZE;
+	if (*w < 1)
+		*w = 1;
+	if (*h < 1)
+		*h = 1;
+}
+
+// Position in field for a pixel center, clamped so it can be interpolated.
+static float _flipclock_sdf_map(int x, float scale, int offset, int max)
+{
+	float u = offset + (x + 0.5f) * scale - 0.5f;
+	if (u < 0)
+		u = 0;
+	if (u > max - 1.001f)
+		u = max - 1.001f;
+	return u;
+}
+
+/**
+ * Write coverage of a glyph scaled to a font size, multiplied by alpha. Field
+ * is interpolated and distances within half a pixel of the edge are smoothed,
+ * so edges are anti-aliased in any size.
+ */
+void flipclock_sdf_render_glyph(const struct flipclock_sdf *sdf, int i,
+				int size, Uint8 alpha, Uint8 pixels[],
+				int pitch)
+{
+	RETURN_IF_FAIL(sdf != NULL);
+	RETURN_IF_FAIL(i >= 0 && i < ATLAS_GLYPHS_LENGTH);
+	RETURN_IF_FAIL(pixels != NULL);
+
+	const SDL_Rect *rect = &sdf->rects[i];
+	int w;
+	int h;
+	flipclock_sdf_get_glyph_size(sdf, i, size, &w, &h);
+	const float scale_x = (float)rect->w / w;
+	const float scale_y = (float)rect->h / h;
+	// Field values to distances in target pixels.
+	const float unit =
+		(float)SDF_SPREAD / SDF_EDGE * 2 / (scale_x + scale_y);
+	// Columns are the same for all rows, compute them once.
+	int *columns = malloc(w * sizeof(*columns));
+	float *weights = malloc(w * sizeof(*weights));
+	if (columns == NULL || weights == NULL) {
+		LOG_ERROR("Failed to render glyph!\n");
+		exit(EXIT_FAILURE);
+	}
+	for (int x = 0; x < w; ++x) {
+		const float u = _flipclock_sdf_map(x, scale_x, rect->x, sdf->w);
+		columns[x] = u;
+		weights[x] = u - columns[x];
+	}
+	for (int y = 0; y < h; ++y) {
+		const float v = _flipclock_sdf_map(y, scale_y, rect->y, sdf->h);
+		const int row = v;
+		const float weight_y = v - row;
+		const Uint16 *top = sdf->field + row * sdf->w;
+		const Uint16 *bottom = top + sdf->w;
+		Uint8 *target = pixels + y * pitch;
+		for (int x = 0; x < w; ++x) {
+			const int c = columns[x];
+			const float weight_x = weights[x];
+			const float upper = top[c] + (top[c + 1] - top[c]) *
+							     weight_x;
+			const float lower =
+				bottom[c] + (bottom[c + 1] - bottom[c]) *
+						    weight_x;
+			const float value = upper + (lower - upper) * weight_y;
+			// Coverage of a pixel on a straight edge.
+			float t = (value - SDF_EDGE) * unit + 0.5f;
+			if (t < 0)
+				t = 0;
+			if (t > 1)
+				t = 1;
+			target[x] = t * alpha + 0.5f;
+		}
+	}
+	free(columns);
+	free(weights);
+}
+
+void flipclock_sdf_destroy(struct flipclock_sdf *sdf)
+{
+	RETURN_IF_FAIL(sdf != NULL);
+
+	free(sdf->field);
+	free(sdf);
+}
@@ -0,0 +1,42 @@
+#ifndef __SDF_H__
+#define __SDF_H__
+
+#include <SDL.h>
+
+#include "atlas.h"
+#include "font.h"
+
+// Glyphs are rasterized once in this size, it is large enough for details.
+#define SDF_FONT_SIZE 128
+// Distance in pixels of `SDF_FONT_SIZE` that is kept around edges.
+#define SDF_SPREAD 8
+/**
+ * Value of edges in field, 8 bits are not enough to keep edges sharp when
+ * scaled up many times.
+ */
+#define SDF_EDGE 32767
+
+/**
+ * Signed distance field of all glyphs in atlas, so atlases of any size can be
+ * sampled from it without FreeType. Each value is distance to the edge of a
+ * glyph, `SDF_EDGE` is the edge and larger values are inside.
+ *
+ * Rects are positions of glyphs inside field, without `SDF_SPREAD` around.
+ * It is never changed after creating, so workers can read it at any time.
+ */
+struct flipclock_sdf {
+	Uint16 *field;
+	int w;
+	int h;
+	SDL_Rect rects[ATLAS_GLYPHS_LENGTH];
+};
+
+struct flipclock_sdf *flipclock_sdf_create(struct flipclock_fonts *fonts);
+void flipclock_sdf_get_glyph_size(const struct flipclock_sdf *sdf, int i,
+				  int size, int *w, int *h);
+void flipclock_sdf_render_glyph(const struct flipclock_sdf *sdf, int i,
+				int size, Uint8 alpha, Uint8 pixels[],
+				int pitch);
+void flipclock_sdf_destroy(struct flipclock_sdf *sdf);
+
+#endif
@@ -0,0 +1,193 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipclock.h"
+#include "stats.h"
+
+// Split seconds out first, so long intervals won't overflow.
+static long long _flipclock_stats_get_us(Uint64 start, Uint64 end)
+{
+	const Uint64 frequency = SDL_GetPerformanceFrequency();
+	const Uint64 ticks = end - start;
+	return ticks / frequency * 1000000 +
+	       ticks % frequency * 1000000 / frequency;
+}
+
+void flipclock_histogram_add(struct flipclock_histogram *histogram,
+			     long long us)
+{
+	RETURN_IF_FAIL(histogram != NULL);
+
+	if (us < 0)
+		us = 0;
+	long long i = us / HISTOGRAM_BUCKET_US;
+	if (i >= HISTOGRAM_BUCKETS)
+		i = HISTOGRAM_BUCKETS - 1;
+	++histogram->buckets[i];
+	++histogram->count;
+	histogram->sum_us += us;
+	if (us > histogram->max_us)
+		histogram->max_us = us;
+}
+
+/**
+ * Returns the upper bound of the bucket that contains the percentile, so it is
+ * never less than the real value, but never more than the slowest sample.
+ */
+long long
+flipclock_histogram_get_percentile(const struct flipclock_histogram *histogram,
+				   double percentile)
+{
+	RETURN_VAL_IF_FAIL(histogram != NULL, 0);
+
+	if (histogram->count == 0)
+		return 0;
+	unsigned int rank = percentile / 100 * histogram->count;
+	if (rank < 1)
+		rank = 1;
+	unsigned int seen = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+		seen += histogram->buckets[i];
+		if (seen >= rank) {
+			long long us = (long long)(i + 1) * HISTOGRAM_BUCKET_US;
+			return us < histogram->max_us ? us : histogram->max_us;
+		}
+	}
+	return histogram->max_us;
+}
+
+void flipclock_stats_init(struct flipclock_stats *stats, int refresh_rate)
+{
+	RETURN_IF_FAIL(stats != NULL);
+
+	memset(stats, 0, sizeof(*stats));
+	stats->refresh_rate =
+		refresh_rate > 0 ? refresh_rate : DEFAULT_REFRESH_RATE;
+}
+
+void flipclock_stats_add_frame(struct flipclock_stats *stats, Uint64 start,
+			       Uint64 drawn, Uint64 presented, bool animating)
+{
+	RETURN_IF_FAIL(stats != NULL);
+
+	flipclock_histogram_add(&stats->frame,
+				_flipclock_stats_get_us(start, presented));
+	flipclock_histogram_add(&stats->redraw,
+				_flipclock_stats_get_us(start, drawn));
+	flipclock_histogram_add(&stats->present,
+				_flipclock_stats_get_us(drawn, presented));
+	/**
+	 * Idle clocks don't present every vsync, so only a frame following one
+	 * that still had animation to draw should be one refresh after it.
+	 * Count how many refreshes are skipped, rounding to the nearest one.
+	 */
+	if (stats->animating && stats->last_present != 0) {
+		const long long period_us = 1000000 / stats->refresh_rate;
+		const long long interval_us =
+			_flipclock_stats_get_us(stats->last_present, presented);
+		const long long refreshes =
+			(interval_us + period_us / 2) / period_us;
+		if (refreshes > 1)
+			stats->missed_vsyncs += refreshes - 1;
+	}
+	stats->last_present = presented;
+	stats->animating = animating;
+}
+
+/**
+ * Startup of a clock is only counted once, cached means glyphs were loaded
+ * from cache, which is a warm start.
+ */
+void flipclock_stats_set_first_frame(struct flipclock_stats *stats,
+				     Uint64 start, Uint64 presented,
+				     bool cached)
+{
+	RETURN_IF_FAIL(stats != NULL);
+
+	if (stats->first_frame_us != 0)
+		return;
+	stats->first_frame_us = _flipclock_stats_get_us(start, presented);
+	// Keep it non-zero so it is not set again.
+	if (stats->first_frame_us == 0)
+		stats->first_frame_us = 1;
+	stats->first_frame_cached = cached;
+}
+
+// Text for HUD, in milliseconds.
+void flipclock_stats_format(const struct flipclock_stats *stats, char buffer[],
+			    size_t size)
+{
+	RETURN_IF_FAIL(stats != NULL);
+	RETURN_IF_FAIL(buffer != NULL);
+
+	const struct flipclock_histogram *histograms[] = {
+		&stats->frame, &stats->redraw, &stats->present
+	};
+	const char *names[] = { "frame", "redraw", "present" };
+	size_t length = 0;
+	for (int i = 0; i < 3 && length < size; ++i) {
+		const struct flipclock_histogram *histogram = histograms[i];
+		length += snprintf(
+			buffer + length, size - length,
+			"%-8s p50 %6.2f  p99 %6.2f  max %6.2f ms\n", names[i],
+			flipclock_histogram_get_percentile(histogram, 50) /
+				1000.0,
+			flipclock_histogram_get_percentile(histogram, 99) /
+				1000.0,
+			histogram->max_us / 1000.0);
+	}
+	if (length < size)
+		length += snprintf(buffer + length, size - length,
+				   "missed vsync %u / %u frames at %d Hz\n",
+				   stats->missed_vsyncs, stats->frame.count,
+				   stats->refresh_rate);
+	if (length < size)
+		snprintf(buffer + length, size - length,
+			 "first frame %.2f ms, %s start",
+			 stats->first_frame_us / 1000.0,
+			 stats->first_frame_cached ? "warm" : "cold");
+}
+
+static void
+_flipclock_histogram_dump(const struct flipclock_histogram *histogram,
+			  const char name[], FILE *file)
+{
+	RETURN_IF_FAIL(histogram != NULL);
+	RETURN_IF_FAIL(name != NULL);
+	RETURN_IF_FAIL(file != NULL);
+
+	fprintf(file,
+		", \"%s\": { \"count\": %u, \"mean_us\": %lld, "
+		"\"p50_us\": %lld, \"p90_us\": %lld, \"p99_us\": %lld, "
+		"\"max_us\": %lld, \"bucket_us\": %d, \"buckets\": [",
+		name, histogram->count,
+		histogram->count > 0 ? histogram->sum_us / histogram->count : 0,
+		flipclock_histogram_get_percentile(histogram, 50),
+		flipclock_histogram_get_percentile(histogram, 90),
+		flipclock_histogram_get_percentile(histogram, 99),
+		histogram->max_us, HISTOGRAM_BUCKET_US);
+	for (int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+		fprintf(file, i == 0 ? "%u" : ", %u", histogram->buckets[i]);
+	fprintf(file, "] }");
+}
+
+// Write one JSON object per line, so results of clocks can be appended.
+void flipclock_stats_dump(const struct flipclock_stats *stats, int clock_i,
+			  FILE *file)
+{
+	RETURN_IF_FAIL(stats != NULL);
+	RETURN_IF_FAIL(file != NULL);
+
+	fprintf(file,
+		"{ \"clock\": %d, \"refresh_rate\": %d, "
+		"\"missed_vsyncs\": %u, \"first_frame_us\": %lld, "
+		"\"first_frame_cache\": \"%s\"",
+		clock_i, stats->refresh_rate, stats->missed_vsyncs,
+		stats->first_frame_us,
+		stats->first_frame_cached ? "warm" : "cold");
+	_flipclock_histogram_dump(&stats->frame, "frame", file);
+	_flipclock_histogram_dump(&stats->redraw, "redraw", file);
+	_flipclock_histogram_dump(&stats->present, "present", file);
+	fprintf(file, " }\n");
+	fflush(file);
+}
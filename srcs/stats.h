@@ -0,0 +1,63 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <SDL.h>
+
+// Each bucket is 250 us, the last bucket also counts all slower samples.
+#define HISTOGRAM_BUCKETS 128
+#define HISTOGRAM_BUCKET_US 250
+#define DEFAULT_REFRESH_RATE 60
+
+struct flipclock_histogram {
+	unsigned int buckets[HISTOGRAM_BUCKETS];
+	unsigned int count;
+	long long sum_us;
+	long long max_us;
+};
+
+/**
+ * Frame timings of a clock, they are only written by the thread that renders
+ * the clock, so read them after it stops.
+ */
+struct flipclock_stats {
+	// From starting to draw a frame to returning from presenting it.
+	struct flipclock_histogram frame;
+	// Drawing layer, faces and cards before presenting.
+	struct flipclock_histogram redraw;
+	// Blocked in `SDL_RenderPresent()`, mostly waiting for vsync.
+	struct flipclock_histogram present;
+	unsigned int missed_vsyncs;
+	int refresh_rate;
+	Uint64 last_present;
+	/**
+	 * Animation was not finished after last frame, so this frame should
+	 * follow it.
+	 */
+	bool animating;
+	// From starting program to presenting the first frame, 0 if not yet.
+	long long first_frame_us;
+	// All glyphs of the first frame are loaded from cache.
+	bool first_frame_cached;
+};
+
+void flipclock_histogram_add(struct flipclock_histogram *histogram,
+			     long long us);
+long long
+flipclock_histogram_get_percentile(const struct flipclock_histogram *histogram,
+				   double percentile);
+void flipclock_stats_init(struct flipclock_stats *stats, int refresh_rate);
+void flipclock_stats_add_frame(struct flipclock_stats *stats, Uint64 start,
+			       Uint64 drawn, Uint64 presented, bool animating);
+void flipclock_stats_set_first_frame(struct flipclock_stats *stats,
+				     Uint64 start, Uint64 presented,
+				     bool cached);
+void flipclock_stats_format(const struct flipclock_stats *stats, char buffer[],
+			    size_t size);
+void flipclock_stats_dump(const struct flipclock_stats *stats, int clock_i,
+			  FILE *file);
+
+#endif
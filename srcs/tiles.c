@@ -0,0 +1,205 @@
+#include <limits.h>
+#include <stdlib.h>
+
+#include "flipclock.h"
+#include "tiles.h"
+
+/**
+ * Renderers report 0 if they have no limit. `FLIPCLOCK_MAX_TEXTURE_SIZE` can
+ * make it smaller, so we can try tiles without a huge display.
+ */
+static void _flipclock_tiles_get_max_size(SDL_Renderer *renderer, int *max_w,
+					  int *max_h)
+{
+	SDL_RendererInfo info;
+	*max_w = INT_MAX;
+	*max_h = INT_MAX;
+	if (SDL_GetRendererInfo(renderer, &info) == 0) {
+		if (info.max_texture_width > 0)
+			*max_w = info.max_texture_width;
+		if (info.max_texture_height > 0)
+			*max_h = info.max_texture_height;
+	}
+	const char *forced = SDL_getenv("FLIPCLOCK_MAX_TEXTURE_SIZE");
+	const int size = forced != NULL ? atoi(forced) : 0;
+	if (size > 0 && size < *max_w)
+		*max_w = size;
+	if (size > 0 && size < *max_h)
+		*max_h = size;
+}
+
+// Returns true if one texture is enough for the given size.
+bool flipclock_tiles_fit(SDL_Renderer *renderer, int w, int h)
+{
+	RETURN_VAL_IF_FAIL(renderer != NULL, false);
+
+	int max_w;
+	int max_h;
+	_flipclock_tiles_get_max_size(renderer, &max_w, &max_h);
+	return w <= max_w && h <= max_h;
+}
+
+struct flipclock_tiles *flipclock_tiles_create(SDL_Renderer *renderer,
+					       Uint32 format, int access, int w,
+					       int h)
+{
+	RETURN_VAL_IF_FAIL(renderer != NULL, NULL);
+	RETURN_VAL_IF_FAIL(w > 0 && h > 0, NULL);
+
+	struct flipclock_tiles *tiles = malloc(sizeof(*tiles));
+	if (tiles == NULL) {
+		LOG_ERROR("Failed to create tiles!\n");
+		exit(EXIT_FAILURE);
+	}
+	int max_w;
+	int max_h;
+	_flipclock_tiles_get_max_size(renderer, &max_w, &max_h);
+	tiles->renderer = renderer;
+	tiles->w = w;
+	tiles->h = h;
+	// Split evenly, so we don't get a very thin last tile.
+	tiles->columns = (w + max_w - 1) / max_w;
+	tiles->rows = (h + max_h - 1) / max_h;
+	tiles->tile_w = (w + tiles->columns - 1) / tiles->columns;
+	tiles->tile_h = (h + tiles->rows - 1) / tiles->rows;
+	const int length = tiles->columns * tiles->rows;
+	// Braces keep the body when `LOG_DEBUG()` is empty.
+	if (length > 1) {
+		LOG_DEBUG("Splitting `%dx%d` into `%dx%d` tiles.\n", w, h,
+			  tiles->columns, tiles->rows);
+	}
+	tiles->textures = malloc(length * sizeof(*tiles->textures));
+	if (tiles->textures == NULL) {
+		LOG_ERROR("Failed to create tiles!\n");
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < length; ++i) {
+		const SDL_Rect rect = flipclock_tiles_get_rect(tiles, i);
+		tiles->textures[i] = SDL_CreateTexture(renderer, format, access,
+						       rect.w, rect.h);
+		if (tiles->textures[i] == NULL) {
+			LOG_ERROR("%s\n", SDL_GetError());
+			exit(EXIT_FAILURE);
+		}
+	}
+	return tiles;
+}
+
+// Upload a surface that may be larger than the max texture size.
+struct flipclock_tiles *
+flipclock_tiles_create_from_surface(SDL_Renderer *renderer,
+				    SDL_Surface *surface)
+{
+	RETURN_VAL_IF_FAIL(renderer != NULL, NULL);
+	RETURN_VAL_IF_FAIL(surface != NULL, NULL);
+
+	struct flipclock_tiles *tiles = flipclock_tiles_create(
+		renderer, surface->format->format, SDL_TEXTUREACCESS_STATIC,
+		surface->w, surface->h);
+	const int bpp = surface->format->BytesPerPixel;
+	for (int i = 0; i < flipclock_tiles_get_length(tiles); ++i) {
+		const SDL_Rect rect = flipclock_tiles_get_rect(tiles, i);
+		const Uint8 *pixels = (Uint8 *)surface->pixels +
+				      rect.y * surface->pitch + rect.x * bpp;
+		if (SDL_UpdateTexture(tiles->textures[i], NULL, pixels,
+				      surface->pitch) < 0) {
+			LOG_ERROR("%s\n", SDL_GetError());
+			exit(EXIT_FAILURE);
+		}
+	}
+	return tiles;
+}
+
+int flipclock_tiles_get_length(const struct flipclock_tiles *tiles)
+{
+	RETURN_VAL_IF_FAIL(tiles != NULL, 0);
+
+	return tiles->columns * tiles->rows;
+}
+
+// Where tile `i` is inside the whole image.
+SDL_Rect flipclock_tiles_get_rect(const struct flipclock_tiles *tiles, int i)
+{
+	SDL_Rect rect = { 0, 0, 0, 0 };
+	RETURN_VAL_IF_FAIL(tiles != NULL, rect);
+
+	rect.x = i % tiles->columns * tiles->tile_w;
+	rect.y = i / tiles->columns * tiles->tile_h;
+	rect.w = tiles->w - rect.x < tiles->tile_w ? tiles->w - rect.x :
+						     tiles->tile_w;
+	rect.h = tiles->h - rect.y < tiles->tile_h ? tiles->h - rect.y :
+						     tiles->tile_h;
+	return rect;
+}
+
+void flipclock_tiles_set_blend_mode(struct flipclock_tiles *tiles,
+				    SDL_BlendMode mode)
+{
+	RETURN_IF_FAIL(tiles != NULL);
+
+	for (int i = 0; i < flipclock_tiles_get_length(tiles); ++i)
+		SDL_SetTextureBlendMode(tiles->textures[i], mode);
+}
+
+// Map a source position to target, neighbor tiles share the same edge.
+static int _flipclock_tiles_map(int x, int source_x, int source_w,
+				int target_x, int target_w)
+{
+	return target_x + (long long)(x - source_x) * target_w / source_w;
+}
+
+/**
+ * Same as `SDL_RenderCopy()` but source rect can cover many tiles, each tile
+ * is copied into its part of target rect, so scaled copies work too. Source
+ * rect can be NULL to copy the whole image.
+ */
+void flipclock_tiles_copy(struct flipclock_tiles *tiles,
+			  const SDL_Rect *source_rect,
+			  const SDL_Rect *target_rect)
+{
+	RETURN_IF_FAIL(tiles != NULL);
+	RETURN_IF_FAIL(target_rect != NULL);
+
+	const SDL_Rect whole_rect = { 0, 0, tiles->w, tiles->h };
+	const SDL_Rect *source = source_rect != NULL ? source_rect :
+						       &whole_rect;
+	if (source->w <= 0 || source->h <= 0)
+		return;
+	const SDL_Rect *target = target_rect;
+	for (int i = 0; i < flipclock_tiles_get_length(tiles); ++i) {
+		const SDL_Rect tile_rect = flipclock_tiles_get_rect(tiles, i);
+		SDL_Rect part;
+		if (!SDL_IntersectRect(source, &tile_rect, &part))
+			continue;
+		const int x0 = _flipclock_tiles_map(part.x, source->x,
+						    source->w, target->x,
+						    target->w);
+		const int x1 = _flipclock_tiles_map(part.x + part.w, source->x,
+						    source->w, target->x,
+						    target->w);
+		const int y0 = _flipclock_tiles_map(part.y, source->y,
+						    source->h, target->y,
+						    target->h);
+		const int y1 = _flipclock_tiles_map(part.y + part.h, source->y,
+						    source->h, target->y,
+						    target->h);
+		if (x1 <= x0 || y1 <= y0)
+			continue;
+		const SDL_Rect tile_source = { part.x - tile_rect.x,
+					       part.y - tile_rect.y, part.w,
+					       part.h };
+		const SDL_Rect tile_target = { x0, y0, x1 - x0, y1 - y0 };
+		SDL_RenderCopy(tiles->renderer, tiles->textures[i],
+			       &tile_source, &tile_target);
+	}
+}
+
+void flipclock_tiles_destroy(struct flipclock_tiles *tiles)
+{
+	RETURN_IF_FAIL(tiles != NULL);
+
+	for (int i = 0; i < flipclock_tiles_get_length(tiles); ++i)
+		SDL_DestroyTexture(tiles->textures[i]);
+	free(tiles->textures);
+	free(tiles);
+}
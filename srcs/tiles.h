@@ -0,0 +1,40 @@
+#ifndef __TILES_H__
+#define __TILES_H__
+
+#include <stdbool.h>
+
+#include <SDL.h>
+
+/**
+ * A large image split into a grid of textures, each one fits the max texture
+ * size of renderer. Tiles are in the same size except the last column and
+ * row, and they are stored row by row.
+ */
+struct flipclock_tiles {
+	SDL_Renderer *renderer;
+	int w;
+	int h;
+	int tile_w;
+	int tile_h;
+	int columns;
+	int rows;
+	SDL_Texture **textures;
+};
+
+bool flipclock_tiles_fit(SDL_Renderer *renderer, int w, int h);
+struct flipclock_tiles *flipclock_tiles_create(SDL_Renderer *renderer,
+					       Uint32 format, int access, int w,
+					       int h);
+struct flipclock_tiles *
+flipclock_tiles_create_from_surface(SDL_Renderer *renderer,
+				    SDL_Surface *surface);
+int flipclock_tiles_get_length(const struct flipclock_tiles *tiles);
+SDL_Rect flipclock_tiles_get_rect(const struct flipclock_tiles *tiles, int i);
+void flipclock_tiles_set_blend_mode(struct flipclock_tiles *tiles,
+				    SDL_BlendMode mode);
+void flipclock_tiles_copy(struct flipclock_tiles *tiles,
+			  const SDL_Rect *source_rect,
+			  const SDL_Rect *target_rect);
+void flipclock_tiles_destroy(struct flipclock_tiles *tiles);
+
+#endif
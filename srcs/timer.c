@@ -0,0 +1,116 @@
+// We need `clock_gettime()` with `-std=c11`.
+#if !defined(_WIN32)
+#	define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipclock.h"
+#include "timer.h"
+
+#define NS_PER_MS 1000000LL
+#define NS_PER_S 1000000000LL
+
+// Nanoseconds since epoch, `time()` only gives us seconds.
+long long flipclock_timer_get_realtime_ns(void)
+{
+#if defined(_WIN32)
+	// `FILETIME` is 100 nanoseconds since 1601-01-01.
+	FILETIME file_time;
+	GetSystemTimeAsFileTime(&file_time);
+	ULARGE_INTEGER large;
+	large.LowPart = file_time.dwLowDateTime;
+	large.HighPart = file_time.dwHighDateTime;
+	return (large.QuadPart - 116444736000000000LL) * 100;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ts.tv_sec * NS_PER_S + ts.tv_nsec;
+#endif
+}
+
+static Uint32 _flipclock_timer_get_delay(int interval)
+{
+	const long long interval_ns = interval * NS_PER_S;
+	long long rest_ns =
+		interval_ns - flipclock_timer_get_realtime_ns() % interval_ns;
+	// Round up so we never wake up before the boundary.
+	return (rest_ns + NS_PER_MS - 1) / NS_PER_MS;
+}
+
+// This runs in SDL's timer thread, so only push event here.
+static Uint32 _flipclock_timer_callback(Uint32 delay, void *data)
+{
+	(void)delay;
+	struct flipclock_timer *timer = data;
+	SDL_Event event;
+	memset(&event, 0, sizeof(event));
+	event.type = timer->event_type;
+	SDL_PushEvent(&event);
+	// Calculate delay every time, so errors won't accumulate.
+	return _flipclock_timer_get_delay(timer->interval);
+}
+
+struct flipclock_timer *flipclock_timer_create(int interval)
+{
+	RETURN_VAL_IF_FAIL(interval > 0, NULL);
+
+	struct flipclock_timer *timer = malloc(sizeof(*timer));
+	if (timer == NULL) {
+		LOG_ERROR("Failed to create timer!\n");
+		exit(EXIT_FAILURE);
+	}
+	timer->event_type = SDL_RegisterEvents(1);
+	if (timer->event_type == (Uint32)-1) {
+		LOG_ERROR("Failed to register timer event!\n");
+		exit(EXIT_FAILURE);
+	}
+	timer->interval = interval;
+	timer->id = SDL_AddTimer(_flipclock_timer_get_delay(interval),
+				 _flipclock_timer_callback, timer);
+	if (timer->id == 0) {
+		LOG_ERROR("%s\n", SDL_GetError());
+		exit(EXIT_FAILURE);
+	}
+	return timer;
+}
+
+void flipclock_timer_set_interval(struct flipclock_timer *timer, int interval)
+{
+	RETURN_IF_FAIL(timer != NULL);
+	RETURN_IF_FAIL(interval > 0);
+
+	if (interval == timer->interval)
+		return;
+	/**
+	 * Restart timer, otherwise we need to wait for the old delay before
+	 * the new interval is used.
+	 */
+	SDL_RemoveTimer(timer->id);
+	timer->interval = interval;
+	timer->id = SDL_AddTimer(_flipclock_timer_get_delay(interval),
+				 _flipclock_timer_callback, timer);
+	if (timer->id == 0) {
+		LOG_ERROR("%s\n", SDL_GetError());
+		exit(EXIT_FAILURE);
+	}
+}
+
+/**
+ * SDL timers only have milliseconds precision and may be a little early or
+ * late, the nearest second is the boundary that we are woken up for.
+ */
+time_t flipclock_timer_get_tick_time(struct flipclock_timer *timer)
+{
+	RETURN_VAL_IF_FAIL(timer != NULL, time(NULL));
+
+	return (flipclock_timer_get_realtime_ns() + NS_PER_S / 2) / NS_PER_S;
+}
+
+void flipclock_timer_destroy(struct flipclock_timer *timer)
+{
+	RETURN_IF_FAIL(timer != NULL);
+
+	SDL_RemoveTimer(timer->id);
+	free(timer);
+}
@@ -0,0 +1,26 @@
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include <time.h>
+
+#include <SDL.h>
+
+/**
+ * A timer pushes an event of `event_type` at every boundary of the interval
+ * (for example every second or every minute) of the realtime clock, so the
+ * main loop only wakes up when displayed time changes.
+ */
+struct flipclock_timer {
+	SDL_TimerID id;
+	Uint32 event_type;
+	// In seconds.
+	int interval;
+};
+
+long long flipclock_timer_get_realtime_ns(void);
+struct flipclock_timer *flipclock_timer_create(int interval);
+void flipclock_timer_set_interval(struct flipclock_timer *timer, int interval);
+time_t flipclock_timer_get_tick_time(struct flipclock_timer *timer);
+void flipclock_timer_destroy(struct flipclock_timer *timer);
+
+#endif
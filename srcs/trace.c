@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipclock.h"
+#include "trace.h"
+
+static struct flipclock_trace *trace = NULL;
+
+/**
+ * Tracing starts before loading configuration, so we can see how long it
+ * takes, call `flipclock_trace_disable()` if we don't need it.
+ */
+void flipclock_trace_create(void)
+{
+	trace = malloc(sizeof(*trace));
+	if (trace == NULL) {
+		LOG_ERROR("Failed to create trace!\n");
+		exit(EXIT_FAILURE);
+	}
+	trace->events = malloc(MAX_TRACE_EVENTS * sizeof(*trace->events));
+	if (trace->events == NULL) {
+		LOG_ERROR("Failed to create trace events!\n");
+		exit(EXIT_FAILURE);
+	}
+	SDL_AtomicSet(&trace->next, 0);
+	SDL_AtomicSet(&trace->enabled, 1);
+	trace->start = SDL_GetPerformanceCounter();
+}
+
+// Only call this before creating other threads.
+void flipclock_trace_disable(void)
+{
+	if (trace == NULL)
+		return;
+	SDL_AtomicSet(&trace->enabled, 0);
+	free(trace->events);
+	trace->events = NULL;
+}
+
+// Returns 0 if tracing is disabled, so the span will be dropped.
+Uint64 flipclock_trace_begin(void)
+{
+	if (trace == NULL || !SDL_AtomicGet(&trace->enabled))
+		return 0;
+	return SDL_GetPerformanceCounter();
+}
+
+void flipclock_trace_end(const char name[], Uint64 start)
+{
+	if (start == 0 || trace == NULL || !SDL_AtomicGet(&trace->enabled))
+		return;
+	const Uint64 end = SDL_GetPerformanceCounter();
+	const unsigned int i = SDL_AtomicAdd(&trace->next, 1);
+	struct flipclock_trace_event *event =
+		&trace->events[i & (MAX_TRACE_EVENTS - 1)];
+	event->name = name;
+	event->start = start;
+	event->end = end;
+	event->thread = SDL_ThreadID();
+}
+
+static double _flipclock_trace_get_us(Uint64 start, Uint64 end)
+{
+	return (double)(end - start) * 1000000.0 /
+	       SDL_GetPerformanceFrequency();
+}
+
+/**
+ * Write Chrome trace JSON, it can be opened with `chrome://tracing` or
+ * <https://ui.perfetto.dev/>. Only call this after all other threads stopped.
+ */
+static void _flipclock_trace_write(const char trace_path[])
+{
+	RETURN_IF_FAIL(trace_path != NULL);
+
+	FILE *file = fopen(trace_path, "w");
+	if (file == NULL) {
+		LOG_ERROR("Failed to open `%s`, trace is dropped!\n",
+			  trace_path);
+		return;
+	}
+	const unsigned int next = SDL_AtomicGet(&trace->next);
+	const unsigned int first =
+		next > MAX_TRACE_EVENTS ? next - MAX_TRACE_EVENTS : 0;
+	if (first > 0)
+		LOG_ERROR("Trace is full, the oldest `%u` spans are dropped.\n",
+			  first);
+	fprintf(file, "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+	for (unsigned int i = first; i < next; ++i) {
+		const struct flipclock_trace_event *event =
+			&trace->events[i & (MAX_TRACE_EVENTS - 1)];
+		fprintf(file,
+			"%s\n\t{ \"name\": \"%s\", \"cat\": \"flipclock\", "
+			"\"ph\": \"X\", \"pid\": 1, \"tid\": %lu, "
+			"\"ts\": %.3f, \"dur\": %.3f }",
+			i == first ? "" : ",", event->name,
+			(unsigned long)event->thread,
+			_flipclock_trace_get_us(trace->start, event->start),
+			_flipclock_trace_get_us(event->start, event->end));
+	}
+	fprintf(file, "\n] }\n");
+	fclose(file);
+	LOG_DEBUG("Wrote `%u` spans into `%s`.\n", next - first, trace_path);
+}
+
+void flipclock_trace_destroy(const char trace_path[])
+{
+	if (trace == NULL)
+		return;
+	if (SDL_AtomicGet(&trace->enabled) && trace_path != NULL &&
+	    trace_path[0] != '\0')
+		_flipclock_trace_write(trace_path);
+	free(trace->events);
+	free(trace);
+	trace = NULL;
+}
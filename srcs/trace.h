@@ -0,0 +1,40 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdbool.h>
+
+#include <SDL.h>
+
+// Must be power of 2 so we can use mask for ring buffer index.
+#define MAX_TRACE_EVENTS 65536
+
+struct flipclock_trace_event {
+	// Names must be static strings, we only keep pointers.
+	const char *name;
+	Uint64 start;
+	Uint64 end;
+	SDL_threadID thread;
+};
+
+/**
+ * Spans of all threads are written into a lock-free ring buffer, each writer
+ * claims a slot with an atomic counter, and the oldest spans are overwritten
+ * if it is full. The buffer is only read after all other threads stopped.
+ *
+ * There is only one trace for the whole program, so we don't need to pass it
+ * to every function we want to measure.
+ */
+struct flipclock_trace {
+	struct flipclock_trace_event *events;
+	SDL_atomic_t next;
+	SDL_atomic_t enabled;
+	Uint64 start;
+};
+
+void flipclock_trace_create(void);
+void flipclock_trace_disable(void);
+Uint64 flipclock_trace_begin(void);
+void flipclock_trace_end(const char name[], Uint64 start);
+void flipclock_trace_destroy(const char trace_path[]);
+
+#endif
@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipclock.h"
+#include "worker.h"
+#include "trace.h"
+
+static int _flipclock_workers_run(void *data)
+{
+	struct flipclock_workers *workers = data;
+
+	SDL_LockMutex(workers->mutex);
+	while (true) {
+		while (workers->running && workers->length == 0)
+			SDL_CondWait(workers->pushed, workers->mutex);
+		// Finish queued jobs before stopping, someone may wait for it.
+		if (workers->length == 0)
+			break;
+		struct flipclock_job *job = workers->jobs[workers->head];
+		workers->head = (workers->head + 1) & (MAX_JOBS - 1);
+		--workers->length;
+		SDL_UnlockMutex(workers->mutex);
+
+		const Uint64 trace_start = flipclock_trace_begin();
+		job->run(job->data);
+		flipclock_trace_end(__func__, trace_start);
+
+		SDL_LockMutex(workers->mutex);
+		SDL_AtomicSet(&job->done, 1);
+		SDL_CondBroadcast(workers->finished);
+	}
+	SDL_UnlockMutex(workers->mutex);
+	return 0;
+}
+
+/**
+ * Create `threads_length` workers, if it is less than 1, use one less than
+ * CPU cores so the render thread still has a core.
+ */
+struct flipclock_workers *flipclock_workers_create(int threads_length)
+{
+	if (threads_length < 1)
+		threads_length = SDL_GetCPUCount() - 1;
+	if (threads_length < 1)
+		threads_length = 1;
+	if (threads_length > MAX_WORKERS)
+		threads_length = MAX_WORKERS;
+
+	struct flipclock_workers *workers = malloc(sizeof(*workers));
+	if (workers == NULL) {
+		LOG_ERROR("Failed to create workers!\n");
+		exit(EXIT_FAILURE);
+	}
+	workers->head = 0;
+	workers->length = 0;
+	workers->running = true;
+	workers->mutex = SDL_CreateMutex();
+	workers->pushed = SDL_CreateCond();
+	workers->finished = SDL_CreateCond();
+	if (workers->mutex == NULL || workers->pushed == NULL ||
+	    workers->finished == NULL) {
+		LOG_ERROR("%s\n", SDL_GetError());
+		exit(EXIT_FAILURE);
+	}
+	LOG_DEBUG("Creating `%d` workers.\n", threads_length);
+	workers->threads_length = threads_length;
+	for (int i = 0; i < threads_length; ++i) {
+		workers->threads[i] = SDL_CreateThread(
+			_flipclock_workers_run, "flipclock-worker", workers);
+		if (workers->threads[i] == NULL) {
+			LOG_ERROR("%s\n", SDL_GetError());
+			exit(EXIT_FAILURE);
+		}
+	}
+	return workers;
+}
+
+void flipclock_job_init(struct flipclock_job *job, flipclock_job_func run,
+			void *data)
+{
+	RETURN_IF_FAIL(job != NULL);
+	RETURN_IF_FAIL(run != NULL);
+
+	job->run = run;
+	job->data = data;
+	SDL_AtomicSet(&job->done, 0);
+}
+
+bool flipclock_job_is_done(struct flipclock_job *job)
+{
+	RETURN_VAL_IF_FAIL(job != NULL, true);
+
+	return SDL_AtomicGet(&job->done);
+}
+
+/**
+ * Workers can be NULL, then the job runs in caller's thread, so callers don't
+ * need a different path for single thread rendering. Also run it in caller's
+ * thread if the queue is full, this won't happen with a few clocks.
+ */
+void flipclock_workers_push(struct flipclock_workers *workers,
+			    struct flipclock_job *job)
+{
+	RETURN_IF_FAIL(job != NULL);
+
+	SDL_AtomicSet(&job->done, 0);
+	if (workers != NULL) {
+		SDL_LockMutex(workers->mutex);
+		if (workers->length < MAX_JOBS) {
+			const int tail =
+				(workers->head + workers->length) &
+				(MAX_JOBS - 1);
+			workers->jobs[tail] = job;
+			++workers->length;
+			SDL_CondSignal(workers->pushed);
+			SDL_UnlockMutex(workers->mutex);
+			return;
+		}
+		SDL_UnlockMutex(workers->mutex);
+		LOG_ERROR("Too many jobs, running it in current thread.\n");
+	}
+	job->run(job->data);
+	SDL_AtomicSet(&job->done, 1);
+}
+
+void flipclock_workers_wait(struct flipclock_workers *workers,
+			    struct flipclock_job *job)
+{
+	RETURN_IF_FAIL(job != NULL);
+
+	if (workers == NULL || flipclock_job_is_done(job))
+		return;
+	const Uint64 trace_start = flipclock_trace_begin();
+	SDL_LockMutex(workers->mutex);
+	while (!flipclock_job_is_done(job))
+		SDL_CondWait(workers->finished, workers->mutex);
+	SDL_UnlockMutex(workers->mutex);
+	flipclock_trace_end(__func__, trace_start);
+}
+
+// Only call this after all jobs' owners are destroyed.
+void flipclock_workers_destroy(struct flipclock_workers *workers)
+{
+	RETURN_IF_FAIL(workers != NULL);
+
+	SDL_LockMutex(workers->mutex);
+	workers->running = false;
+	SDL_CondBroadcast(workers->pushed);
+	SDL_UnlockMutex(workers->mutex);
+	for (int i = 0; i < workers->threads_length; ++i)
+		SDL_WaitThread(workers->threads[i], NULL);
+	SDL_DestroyCond(workers->finished);
+	SDL_DestroyCond(workers->pushed);
+	SDL_DestroyMutex(workers->mutex);
+	free(workers);
+}
@@ -0,0 +1,53 @@
+#ifndef __WORKER_H__
+#define __WORKER_H__
+
+#include <stdbool.h>
+
+#include <SDL.h>
+
+// Must be power of 2 so we can use mask for ring buffer index.
+#define MAX_JOBS 64
+#define MAX_WORKERS 8
+
+typedef void (*flipclock_job_func)(void *data);
+
+/**
+ * Jobs are owned by callers, they must stay valid until finished, so callers
+ * should wait for them before freeing.
+ */
+struct flipclock_job {
+	flipclock_job_func run;
+	void *data;
+	SDL_atomic_t done;
+};
+
+/**
+ * A fixed size thread pool for CPU work that does not need a renderer, like
+ * rasterizing glyphs. Renderers are not thread-safe so results are uploaded
+ * by the thread that owns the renderer.
+ */
+struct flipclock_workers {
+	SDL_Thread *threads[MAX_WORKERS];
+	int threads_length;
+	struct flipclock_job *jobs[MAX_JOBS];
+	int head;
+	int length;
+	SDL_mutex *mutex;
+	// Signaled when a job is pushed or workers should stop.
+	SDL_cond *pushed;
+	// Signaled when a job is finished.
+	SDL_cond *finished;
+	bool running;
+};
+
+struct flipclock_workers *flipclock_workers_create(int threads_length);
+void flipclock_job_init(struct flipclock_job *job, flipclock_job_func run,
+			void *data);
+bool flipclock_job_is_done(struct flipclock_job *job);
+void flipclock_workers_push(struct flipclock_workers *workers,
+			    struct flipclock_job *job);
+void flipclock_workers_wait(struct flipclock_workers *workers,
+			    struct flipclock_job *job);
+void flipclock_workers_destroy(struct flipclock_workers *workers);
+
+#endif
@@ -0,0 +1,384 @@
+// We need `localtime_r()` and `tzset()` with `-std=c11`.
+#if !defined(_WIN32)
+#	define _POSIX_C_SOURCE 200809L
+#endif
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flipclock.h"
+#include "timer.h"
+#include "trace.h"
+#include "zone.h"
+
+/**
+ * Only Linux has inotify, other platforms still find zone changes by `TZ`
+ * and clock jumps.
+ */
+#if defined(__linux__) && !defined(__ANDROID__)
+#	define HAVE_INOTIFY
+#	include <sys/inotify.h>
+#	include <unistd.h>
+#endif
+
+#define NS_PER_S 1000000000LL
+#define SECONDS_PER_DAY 86400LL
+
+// Days since 1970-01-01 of a date in proleptic Gregorian calendar.
+static long long _flipclock_zone_days_from_civil(long long year, int month,
+						 int day)
+{
+	year -= month <= 2;
+	const long long era = (year >= 0 ? year : year - 399) / 400;
+	const long long year_of_era = year - era * 400;
+	const long long day_of_year =
+		(153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	const long long day_of_era = year_of_era * 365 + year_of_era / 4 -
+				     year_of_era / 100 + day_of_year;
+	return era * 146097 + day_of_era - 719468;
+}
+
+// See <https://howardhinnant.github.io/date_algorithms.html>.
+static void _flipclock_zone_civil_from_days(long long days, long long *year,
+					    int *month, int *day)
+{
+	days += 719468;
+	const long long era = (days >= 0 ? days : days - 146096) / 146097;
+	const long long day_of_era = days - era * 146097;
+	const long long year_of_era =
+		(day_of_era - day_of_era / 1460 + day_of_era / 36524 -
+		 day_of_era / 146096) /
+		365;
+	const long long day_of_year =
+		day_of_era -
+		(365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+	const int shifted_month = (5 * day_of_year + 2) / 153;
+	*day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+	*month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+	*year = year_of_era + era * 400 + (*month <= 2);
+}
+
+static long long _flipclock_zone_get_monotonic_ns(void)
+{
+	const Uint64 counter = SDL_GetPerformanceCounter();
+	const Uint64 frequency = SDL_GetPerformanceFrequency();
+	// Split it, or multiplying nanoseconds overflows.
+	return (long long)(counter / frequency) * NS_PER_S +
+	       (long long)(counter % frequency * NS_PER_S / frequency);
+}
+
+// The only place we ask C library, and only when offset is not valid.
+static void _flipclock_zone_probe(long long time, long *offset, bool *dst)
+{
+	const time_t raw_time = time;
+	struct tm tm;
+#if defined(_WIN32)
+	localtime_s(&tm, &raw_time);
+#else
+	localtime_r(&raw_time, &tm);
+#endif
+	const long long local =
+		_flipclock_zone_days_from_civil(tm.tm_year + 1900LL,
+						tm.tm_mon + 1, tm.tm_mday) *
+			SECONDS_PER_DAY +
+		tm.tm_hour * 3600LL + tm.tm_min * 60LL + tm.tm_sec;
+	*offset = local - time;
+	*dst = tm.tm_isdst > 0;
+}
+
+/**
+ * C library only converts time in `TZ`, so named zones set it while probing
+ * and restore it after. Other threads may read environment, so this must only
+ * be called before they are created.
+ */
+static void _flipclock_zone_set_tz(const char tz[])
+{
+#if defined(_WIN32)
+	// Empty value removes it.
+	_putenv_s("TZ", tz != NULL ? tz : "");
+	_tzset();
+#else
+	if (tz != NULL)
+		setenv("TZ", tz, 1);
+	else
+		unsetenv("TZ");
+	tzset();
+#endif
+}
+
+static void _flipclock_zone_save_tz(struct flipclock_zone *zone)
+{
+	const char *tz = getenv("TZ");
+	zone->has_tz = tz != NULL;
+	strncpy(zone->tz, tz != NULL ? tz : "", MAX_BUFFER_LENGTH);
+	zone->tz[MAX_BUFFER_LENGTH - 1] = '\0';
+}
+
+/**
+ * Find the first second after `time` that has a different offset by stepping
+ * days and bisecting, returns `time + horizon` if offset does not change.
+ */
+static long long _flipclock_zone_find_change(long long time, long long horizon,
+					     long offset, bool dst)
+{
+	long long before = time;
+	for (long long after = time + ZONE_STEP; after < time + horizon;
+	     after += ZONE_STEP) {
+		long next_offset;
+		bool next_dst;
+		_flipclock_zone_probe(after, &next_offset, &next_dst);
+		if (next_offset == offset && next_dst == dst) {
+			before = after;
+			continue;
+		}
+		// Offset changes in (before, after].
+		while (after - before > 1) {
+			const long long middle = before + (after - before) / 2;
+			_flipclock_zone_probe(middle, &next_offset, &next_dst);
+			if (next_offset == offset && next_dst == dst)
+				before = middle;
+			else
+				after = middle;
+		}
+		return after;
+	}
+	return time + horizon;
+}
+
+/**
+ * Probe all offsets of a named zone in `ZONE_TABLE_HORIZON`, the last one is
+ * used after it. Zones are only created while loading config, so it is safe
+ * to change `TZ` here.
+ */
+static void _flipclock_zone_probe_spans(struct flipclock_zone *zone,
+					long long time)
+{
+	const Uint64 trace_start = flipclock_trace_begin();
+	char local_tz[MAX_BUFFER_LENGTH];
+	const char *tz = getenv("TZ");
+	const bool has_local_tz = tz != NULL;
+	strncpy(local_tz, tz != NULL ? tz : "", MAX_BUFFER_LENGTH);
+	local_tz[MAX_BUFFER_LENGTH - 1] = '\0';
+	_flipclock_zone_set_tz(zone->name);
+	const long long end = time + ZONE_TABLE_HORIZON;
+	zone->spans_length = 0;
+	while (zone->spans_length < MAX_ZONE_SPANS && time < end) {
+		struct flipclock_zone_span *span =
+			&zone->spans[zone->spans_length++];
+		span->from = time;
+		_flipclock_zone_probe(time, &span->offset, &span->dst);
+		time = _flipclock_zone_find_change(time, end - time,
+						   span->offset, span->dst);
+	}
+	_flipclock_zone_set_tz(has_local_tz ? local_tz : NULL);
+	flipclock_trace_end(__func__, trace_start);
+}
+
+/**
+ * Named zones look up probed offsets. Local zone asks C library for offset of
+ * the time, and the next second that has a different offset, it only happens
+ * a few times a year.
+ */
+static void _flipclock_zone_update(struct flipclock_zone *zone, long long time)
+{
+	const Uint64 trace_start = flipclock_trace_begin();
+	if (zone->name[0] != '\0') {
+		int i = 0;
+		while (i + 1 < zone->spans_length &&
+		       zone->spans[i + 1].from <= time)
+			++i;
+		zone->offset = zone->spans[i].offset;
+		zone->dst = zone->spans[i].dst;
+		// Realtime jumped before creating, just use the first one.
+		zone->valid_from = i == 0 ? LLONG_MIN : zone->spans[i].from;
+		zone->valid_until = i + 1 < zone->spans_length ?
+					    zone->spans[i + 1].from :
+					    LLONG_MAX;
+	} else {
+		// Let C library read `TZ` and zone file again.
+#if defined(_WIN32)
+		_tzset();
+#else
+		tzset();
+#endif
+		_flipclock_zone_save_tz(zone);
+		_flipclock_zone_probe(time, &zone->offset, &zone->dst);
+		zone->valid_from = time;
+		zone->valid_until = _flipclock_zone_find_change(
+			time, ZONE_HORIZON, zone->offset, zone->dst);
+	}
+	zone->valid = true;
+	LOG_DEBUG("Using UTC offset `%ld` for `%s` until `%lld`.\n",
+		  zone->offset, zone->name[0] != '\0' ? zone->name : "local",
+		  zone->valid_until);
+	flipclock_trace_end(__func__, trace_start);
+}
+
+// Pass NULL for local timezone, otherwise a value of `TZ`.
+struct flipclock_zone *flipclock_zone_create(const char name[])
+{
+	struct flipclock_zone *zone = malloc(sizeof(*zone));
+	if (zone == NULL) {
+		LOG_ERROR("Failed to create zone!\n");
+		exit(EXIT_FAILURE);
+	}
+	strncpy(zone->name, name != NULL ? name : "", MAX_BUFFER_LENGTH);
+	zone->name[MAX_BUFFER_LENGTH - 1] = '\0';
+	if (strlen(zone->name) == MAX_BUFFER_LENGTH - 1)
+		LOG_ERROR("Timezone `%s` too long, may be wrong.\n", name);
+	zone->offset = 0;
+	zone->dst = false;
+	zone->valid_from = 0;
+	zone->valid_until = 0;
+	zone->valid = false;
+	zone->anchor_ns = flipclock_timer_get_realtime_ns() -
+			  _flipclock_zone_get_monotonic_ns();
+	_flipclock_zone_save_tz(zone);
+	zone->inotify_fd = -1;
+	zone->spans_length = 0;
+	// Named zones don't follow system timezone.
+	if (zone->name[0] != '\0') {
+		_flipclock_zone_probe_spans(zone, flipclock_zone_get_now(zone));
+		return zone;
+	}
+#if defined(HAVE_INOTIFY)
+	/**
+	 * `/etc/localtime` is a symlink replaced by `timedatectl`, so watch
+	 * the dir, watching the file misses the new one.
+	 */
+	zone->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (zone->inotify_fd >= 0 &&
+	    inotify_add_watch(zone->inotify_fd, "/etc",
+			      IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE |
+				      IN_DELETE | IN_ATTRIB) < 0) {
+		close(zone->inotify_fd);
+		zone->inotify_fd = -1;
+	}
+	if (zone->inotify_fd < 0)
+		LOG_ERROR("Failed to watch `/etc/localtime`, "
+			  "zone changes are only found by `TZ`.\n");
+#endif
+	return zone;
+}
+
+/**
+ * Realtime derived from monotonic clock, so it never goes back between two
+ * checks, a jump is applied by `flipclock_zone_check()`.
+ */
+long long flipclock_zone_get_realtime_ns(const struct flipclock_zone *zone)
+{
+	RETURN_VAL_IF_FAIL(zone != NULL, flipclock_timer_get_realtime_ns());
+
+	return _flipclock_zone_get_monotonic_ns() + zone->anchor_ns;
+}
+
+time_t flipclock_zone_get_now(const struct flipclock_zone *zone)
+{
+	RETURN_VAL_IF_FAIL(zone != NULL, time(NULL));
+
+	return flipclock_zone_get_realtime_ns(zone) / NS_PER_S;
+}
+
+// Same as `localtime_r()`, except `tm_gmtoff` and `tm_zone` are not set.
+void flipclock_zone_get_time(struct flipclock_zone *zone, time_t time,
+			     struct tm *tm)
+{
+	RETURN_IF_FAIL(zone != NULL);
+	RETURN_IF_FAIL(tm != NULL);
+
+	if (!zone->valid || time < zone->valid_from ||
+	    time >= zone->valid_until)
+		_flipclock_zone_update(zone, time);
+	const long long local = (long long)time + zone->offset;
+	long long days = local / SECONDS_PER_DAY;
+	long long seconds = local % SECONDS_PER_DAY;
+	// Round down for times before 1970.
+	if (seconds < 0) {
+		seconds += SECONDS_PER_DAY;
+		--days;
+	}
+	long long year;
+	int month;
+	int day;
+	_flipclock_zone_civil_from_days(days, &year, &month, &day);
+	memset(tm, 0, sizeof(*tm));
+	tm->tm_year = year - 1900;
+	tm->tm_mon = month - 1;
+	tm->tm_mday = day;
+	tm->tm_hour = seconds / 3600;
+	tm->tm_min = seconds / 60 % 60;
+	tm->tm_sec = seconds % 60;
+	// 1970-01-01 is Thursday.
+	tm->tm_wday = ((days + 4) % 7 + 7) % 7;
+	tm->tm_yday = days - _flipclock_zone_days_from_civil(year, 1, 1);
+	tm->tm_isdst = zone->dst;
+}
+
+#if defined(HAVE_INOTIFY)
+static bool _flipclock_zone_read_inotify(struct flipclock_zone *zone)
+{
+	bool changed = false;
+	// Make sure buffer is aligned for events.
+	char buffer[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t length;
+	while ((length = read(zone->inotify_fd, buffer, sizeof(buffer))) > 0) {
+		for (ssize_t i = 0; i < length;) {
+			const struct inotify_event *event =
+				(const struct inotify_event *)(buffer + i);
+			if (event->len > 0 &&
+			    !strcmp(event->name, "localtime"))
+				changed = true;
+			i += sizeof(*event) + event->len;
+		}
+	}
+	return changed;
+}
+#endif
+
+/**
+ * Returns true if offset is not valid anymore or realtime jumped, so callers
+ * should convert current time again. It is cheap enough for every loop.
+ */
+bool flipclock_zone_check(struct flipclock_zone *zone)
+{
+	RETURN_VAL_IF_FAIL(zone != NULL, false);
+
+	bool changed = false;
+	const long long anchor_ns = flipclock_timer_get_realtime_ns() -
+				    _flipclock_zone_get_monotonic_ns();
+	const long long drift_ns = anchor_ns - zone->anchor_ns;
+	// Small drift is NTP slewing clock, just follow it.
+	zone->anchor_ns = anchor_ns;
+	if (drift_ns > ZONE_MAX_JUMP_NS || drift_ns < -ZONE_MAX_JUMP_NS) {
+		LOG_DEBUG("Realtime jumped `%lld` ms.\n", drift_ns / 1000000);
+		changed = true;
+	}
+	const char *tz = getenv("TZ");
+	if (zone->name[0] == '\0' &&
+	    ((tz != NULL) != zone->has_tz ||
+	     (tz != NULL && strncmp(tz, zone->tz, MAX_BUFFER_LENGTH - 1)))) {
+		LOG_DEBUG("`TZ` changed.\n");
+		zone->valid = false;
+		changed = true;
+	}
+#if defined(HAVE_INOTIFY)
+	if (zone->inotify_fd >= 0 && _flipclock_zone_read_inotify(zone)) {
+		LOG_DEBUG("`/etc/localtime` changed.\n");
+		zone->valid = false;
+		changed = true;
+	}
+#endif
+	return changed;
+}
+
+void flipclock_zone_destroy(struct flipclock_zone *zone)
+{
+	RETURN_IF_FAIL(zone != NULL);
+
+#if defined(HAVE_INOTIFY)
+	if (zone->inotify_fd >= 0)
+		close(zone->inotify_fd);
+#endif
+	free(zone);
+}
@@ -0,0 +1,75 @@
+#ifndef __ZONE_H__
+#define __ZONE_H__
+
+#include <stdbool.h>
+#include <time.h>
+
+#include <SDL.h>
+
+#include "flipclock.h"
+
+// How far we look ahead for the next DST transition, in seconds.
+#define ZONE_HORIZON (366 * 24 * 3600)
+// Transitions closer than this to each other may be missed.
+#define ZONE_STEP (24 * 3600)
+// Realtime moving more than this against monotonic clock is a jump.
+#define ZONE_MAX_JUMP_NS 1000000000LL
+// How far named zones are probed when they are created, in seconds.
+#define ZONE_TABLE_HORIZON (10LL * ZONE_HORIZON)
+// Offsets kept for a named zone, most zones change twice a year.
+#define MAX_ZONE_SPANS 32
+
+// Seconds from `from` to `from` of the next span use the same offset.
+struct flipclock_zone_span {
+	long long from;
+	long offset;
+	bool dst;
+};
+
+/**
+ * Converting time to local time with `localtime()` may check `TZ` and zone
+ * files every time, and it is not thread-safe. Instead we ask C library for
+ * UTC offset once, and find when it changes next, then broken-down times
+ * before it are calculated from offset with integer arithmetic.
+ *
+ * Offset is calculated again if `/etc/localtime` changes, `TZ` changes or
+ * realtime clock jumps against monotonic clock, call `flipclock_zone_check()`
+ * in main loop to find them.
+ *
+ * A zone created with a name always uses that timezone instead of local one,
+ * so many clocks can show different zones from the same time. C library only
+ * converts time in `TZ`, and changing environment is not safe once other
+ * threads exist, so offsets of named zones are all probed when they are
+ * created, which happens while loading config.
+ */
+struct flipclock_zone {
+	// Value of `TZ` used for this zone, empty for local timezone.
+	char name[MAX_BUFFER_LENGTH];
+	// Seconds east of UTC.
+	long offset;
+	bool dst;
+	// Offset is only valid for seconds in [valid_from, valid_until).
+	long long valid_from;
+	long long valid_until;
+	bool valid;
+	// Realtime minus monotonic time, it changes if realtime jumps.
+	long long anchor_ns;
+	// `TZ` when offset is calculated, empty if it is not set.
+	char tz[MAX_BUFFER_LENGTH];
+	bool has_tz;
+	// Watching `/etc/` for `localtime`, -1 if not supported.
+	int inotify_fd;
+	// Offsets of a named zone, sorted by `from`.
+	struct flipclock_zone_span spans[MAX_ZONE_SPANS];
+	int spans_length;
+};
+
+struct flipclock_zone *flipclock_zone_create(const char name[]);
+long long flipclock_zone_get_realtime_ns(const struct flipclock_zone *zone);
+time_t flipclock_zone_get_now(const struct flipclock_zone *zone);
+void flipclock_zone_get_time(struct flipclock_zone *zone, time_t time,
+			     struct tm *tm);
+bool flipclock_zone_check(struct flipclock_zone *zone);
+void flipclock_zone_destroy(struct flipclock_zone *zone);
+
+#endif
@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <SDL.h>
+
+#include "queue.h"
+
+#define MESSAGES_LENGTH (3 * MAX_MESSAGES)
+
+static void _flipclock_test_handle(void *data,
+				   const struct flipclock_message *message)
+{
+	int *handled = data;
+
+	if (message->card_i != *handled) {
+		fprintf(stderr, "Got message `%d`, expected `%d`!\n",
+			message->card_i, *handled);
+		exit(EXIT_FAILURE);
+	}
+	++*handled;
+}
+
+/**
+ * Main thread renders clocks without render threads, so it pushes and pops
+ * the same queue, and must not wait for itself when the queue is full.
+ */
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	struct flipclock_queue *queue = flipclock_queue_create();
+	int handled = 0;
+	flipclock_queue_set_handle(queue, _flipclock_test_handle, &handled);
+	struct flipclock_message message = { 0 };
+	message.type = FLIPCLOCK_MESSAGE_EXPOSE;
+	for (int i = 0; i < MESSAGES_LENGTH; ++i) {
+		message.card_i = i;
+		flipclock_queue_push(queue, &message);
+	}
+	while (flipclock_queue_pop(queue, &message))
+		_flipclock_test_handle(&handled, &message);
+	flipclock_queue_destroy(queue);
+	if (handled != MESSAGES_LENGTH) {
+		fprintf(stderr, "Handled `%d` messages, expected `%d`!\n",
+			handled, MESSAGES_LENGTH);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}